@@ -0,0 +1,95 @@
+#include <chrono>
+#include <iostream>
+#include "BulkExporter.h"
+
+BulkExporter::BulkExporter(Rasterizer* rasterizer)
+    : settings(nullptr), rasterizer(rasterizer), tileWriter(), tileManifest(), tilePyramid(), rasterizationBuffer(nullptr), costBuffer(nullptr)
+{ }
+
+BulkExporter::~BulkExporter()
+{
+    if (rasterizationBuffer != nullptr)
+    {
+        delete[] rasterizationBuffer;
+    }
+
+    if (costBuffer != nullptr)
+    {
+        delete[] costBuffer;
+    }
+}
+
+bool BulkExporter::Export(Settings* settings)
+{
+    this->settings = settings;
+    tileWriter.Setup(settings);
+    tileManifest.Setup(settings, &tileWriter);
+
+    rasterizationBuffer = new double[settings->RegionSize * settings->RegionSize];
+    if (settings->ExportCostMaps)
+    {
+        costBuffer = new RasterCost[settings->RegionSize * settings->RegionSize];
+    }
+
+    if (!tileWriter.CreateOutputFolder())
+    {
+        return false;
+    }
+
+    if (settings->IsBuildingPyramid && !tilePyramid.Setup(settings, &tileWriter))
+    {
+        return false;
+    }
+
+    double viewSize = 1.0 / (double)settings->RegionCount;
+    for (int regionY = settings->TileRangeMinY; regionY <= settings->TileRangeMaxY; regionY++)
+    {
+        if (!tileWriter.CreateRowFolder(regionY))
+        {
+            return false;
+        }
+
+        for (int regionX = settings->TileRangeMinX; regionX <= settings->TileRangeMaxX; regionX++)
+        {
+            auto startTime = std::chrono::steady_clock::now();
+            rasterizer->Rasterize((double)regionX * viewSize, (double)regionY * viewSize, viewSize, &rasterizationBuffer, costBuffer);
+            std::chrono::duration<double> rasterTime = std::chrono::steady_clock::now() - startTime;
+            std::cout << "Raster time: " << rasterTime.count() << " s." << std::endl;
+
+            if (!tileWriter.WriteHeightTile(regionX, regionY, rasterizationBuffer))
+            {
+                return false;
+            }
+
+            if (settings->IsBuildingPyramid && !tilePyramid.AddTile(regionX, regionY, rasterizationBuffer))
+            {
+                return false;
+            }
+
+            if (settings->ExportCostMaps)
+            {
+                tileWriter.WriteCostTile(regionX, regionY, costBuffer);
+            }
+
+            tileManifest.AddTile(regionX, regionY);
+        }
+    }
+
+    if (settings->IsBuildingPyramid && !tilePyramid.Finish())
+    {
+        return false;
+    }
+
+    if (settings->HasTileRange && !tileManifest.Write())
+    {
+        return false;
+    }
+
+    if (!tileWriter.Finish())
+    {
+        return false;
+    }
+
+    std::cout << "Tiling and rasterization done!" << std::endl;
+    return true;
+}
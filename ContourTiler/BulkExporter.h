@@ -0,0 +1,27 @@
+#pragma once
+#include "Rasterizer.h"
+#include "RasterCost.h"
+#include "Settings.h"
+#include "TileManifest.h"
+#include "TilePyramid.h"
+#include "TileWriter.h"
+
+// Rasterizes every region to tiles without a graphical display.
+class BulkExporter
+{
+    Settings* settings;
+    Rasterizer* rasterizer;
+    TileWriter tileWriter;
+    TileManifest tileManifest;
+    TilePyramid tilePyramid;
+
+    double* rasterizationBuffer;
+    RasterCost* costBuffer;
+
+public:
+    BulkExporter(Rasterizer* rasterizer);
+    virtual ~BulkExporter();
+
+    // Rasterizes and writes out all [RegionCount]x[RegionCount] regions, or those in the tile range.
+    bool Export(Settings* settings);
+};
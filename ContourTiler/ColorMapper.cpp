@@ -1,6 +1,20 @@
+#include <algorithm>
 #include <cmath>
 #include "ColorMapper.h"
 
+ColorMapper::ColorMapper()
+{
+    for (int i = 0; i < TableSize; i++)
+    {
+        MapColor((double)i / (double)(TableSize - 1), &colorTable[i * 3], &colorTable[i * 3 + 1], &colorTable[i * 3 + 2]);
+    }
+
+    for (int i = 0; i < 256; i++)
+    {
+        contourBlendTable[i] = (unsigned char)std::min(255, i + 50);
+    }
+}
+
 void ColorMapper::MapColor(double percent, unsigned char* red, unsigned char* green, unsigned char* blue)
 {
     // Do a HSV -> RGB conversion.
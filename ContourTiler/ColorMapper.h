@@ -1,8 +1,31 @@
 #pragma once
 class ColorMapper
 {
+    static const int TableSize = 4096;
+
+    // MapColor sampled from 0-1, and the brightening of each channel value under contour lines.
+    unsigned char colorTable[TableSize * 3];
+    unsigned char contourBlendTable[256];
+
 public:
+    ColorMapper();
+
     // Maps a percent from 0-1 to a nice color.
     static void MapColor(double percent, unsigned char* red, unsigned char* green, unsigned char* blue);
-};
 
+    // As MapColor, from the table instead. Percents outside of 0-1 are clamped.
+    void LookupColor(double percent, unsigned char* red, unsigned char* green, unsigned char* blue) const
+    {
+        double clampedPercent = percent > 0.0 ? (percent < 1.0 ? percent : 1.0) : 0.0;
+        const unsigned char* color = &colorTable[(int)(clampedPercent * (double)(TableSize - 1) + 0.5) * 3];
+        *red = color[0];
+        *green = color[1];
+        *blue = color[2];
+    }
+
+    // Brightens a color channel under a contour line.
+    unsigned char BlendContour(unsigned char value) const
+    {
+        return contourBlendTable[value];
+    }
+};
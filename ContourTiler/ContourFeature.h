@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include "Point.h"
+
+// Points of a single line set of a feature, in input coordinates.
+struct ContourLineSet
+{
+    const Point* points;
+    size_t count;
+};
+
+// A contour feature of an input file (a GeoJSON MultiLineString or a shapefile PolyLine) and its elevation.
+struct ContourFeature
+{
+    double elevation;
+    const ContourLineSet* lineSets;
+    size_t lineSetCount;
+};
@@ -1,17 +1,13 @@
 #include <array>
 #include <algorithm>
 #include <cmath>
-#include <direct.h>
 #include <iostream>
 #include <future>
 #include <limits>
 #include <string>
 #include <sstream>
 #include <thread>
-#include <GL/glew.h>
-#include <SFML/OpenGL.hpp>
 #include <SFML/Graphics.hpp>
-#include <stb/stb_image_write.h>
 #include "ContourTiler.h"
 #include "Settings.h"
 
@@ -26,9 +22,9 @@
 #endif
 
 ContourTiler::ContourTiler()
-    : lineStripLoader(), rasterizer(&lineStripLoader), rasterizationBuffer(nullptr), linesBuffer(nullptr),
+    : lineStripLoader(), rasterizer(&lineStripLoader), rasterizationBuffer(nullptr), linesBuffer(nullptr), costBuffer(nullptr), heatmapMode(HeatmapOff),
       leftOffset((double)0.0), topOffset((double)0.0), effectiveSize((double)1.0), mouseStart(-1, -1), mousePos(-1, -1),
-      isRendering(false), isZoomMode(true), rerender(false),
+      isRendering(false), isLoaded(false), isIndexing(false), isPreviewReady(false), isZoomMode(true), rerender(false), isTextureStale(true),
       isBulkProcessing(false), regionX(0), regionY(0),
       outputHelp(false)
 { }
@@ -44,6 +40,11 @@ ContourTiler::~ContourTiler()
     {
         delete[] linesBuffer;
     }
+
+    if (costBuffer != nullptr)
+    {
+        delete[] costBuffer;
+    }
 }
 
 void ContourTiler::OutputDisplayHelp()
@@ -55,6 +56,7 @@ void ContourTiler::OutputDisplayHelp()
     std::cout << "    R: Resets the view to the default region" << std::endl;
     std::cout << "    L: Enables or disables rendering contour lines." << std::endl;
     std::cout << "    C: Enables or disables rendering a color spectrum overlay." << std::endl;
+    std::cout << "    H: Cycles the search cost heatmap overlay between off, rings visited, segments tested, and sectors filled." << std::endl;
     std::cout << "  Export" << std::endl;
     std::cout << "    P: Starts bulk processing, dividing up the image into regions and rendering heightmaps" << std::endl;
     std::cout << std::endl;
@@ -65,6 +67,9 @@ void ContourTiler::OutputDisplayHelp()
 
 void ContourTiler::HandleEvents(sf::RenderWindow& window, bool& alive)
 {
+    // The loading thread previews the current view, so it can't change until loading is done.
+    bool isViewLocked = !isLoaded;
+
     // Handle all events.
     sf::Event event;
     while (window.pollEvent(event))
@@ -75,7 +80,7 @@ void ContourTiler::HandleEvents(sf::RenderWindow& window, bool& alive)
         }
         else if (event.type == sf::Event::KeyReleased)
         {
-            if (event.key.code == sf::Keyboard::R)
+            if (event.key.code == sf::Keyboard::R && !isViewLocked)
             {
                 // Reset
                 topOffset = 0.0f;
@@ -89,14 +94,24 @@ void ContourTiler::HandleEvents(sf::RenderWindow& window, bool& alive)
                 // Contour lines
                 this->renderContours = !this->renderContours;
                 std::cout << "Toggled contour rendering: " << (this->renderContours ? "on" : "off") << std::endl;
+                isTextureStale = true;
             }
             else if (event.key.code == sf::Keyboard::C)
             {
                 // Colorize (true/false)
                 this->renderColors = !this->renderColors;
                 std::cout << "Toggled color rendering: " << (this->renderColors ? "on" : "off") << std::endl;
+                isTextureStale = true;
+            }
+            else if (event.key.code == sf::Keyboard::H)
+            {
+                // Search cost heatmap
+                this->heatmapMode = (this->heatmapMode + 1) % HeatmapModeCount;
+                const char* heatmapNames[] = { "off", "rings visited", "segments tested", "sectors filled" };
+                std::cout << "Toggled heatmap rendering: " << heatmapNames[this->heatmapMode] << std::endl;
+                isTextureStale = true;
             }
-            else if (event.key.code == sf::Keyboard::P)
+            else if (event.key.code == sf::Keyboard::P && !isViewLocked)
             {
                 // Bulk processing divides the area into 3-ft resolution areas (regionSize x regionSize or 70x70) all 1000x1000 pixels.
                 std::cout << "Starting bulk processing mode." << std::endl;
@@ -108,13 +123,13 @@ void ContourTiler::HandleEvents(sf::RenderWindow& window, bool& alive)
         }
         else if (event.type == sf::Event::MouseButtonPressed)
         {
-            if (event.mouseButton.button == sf::Mouse::Left)
+            if (event.mouseButton.button == sf::Mouse::Left && !isViewLocked)
             {
                 // Zoom-in preparation
                 mouseStart = sf::Vector2i(event.mouseButton.x, event.mouseButton.y);
                 mousePos = mouseStart;
             }
-            else if (event.mouseButton.button == sf::Mouse::Right)
+            else if (event.mouseButton.button == sf::Mouse::Right && !isViewLocked)
             {
                 // Zoom-out.
                 topOffset -= effectiveSize * 0.50f;
@@ -151,7 +166,7 @@ void ContourTiler::HandleEvents(sf::RenderWindow& window, bool& alive)
         }
         else if (event.type == sf::Event::MouseButtonReleased)
         {
-            if (event.mouseButton.button == sf::Mouse::Left)
+            if (event.mouseButton.button == sf::Mouse::Left && mouseStart.x != -1)
             {
                 int xNew = event.mouseButton.x;
                 int yNew = event.mouseButton.y;
@@ -194,9 +209,18 @@ void ContourTiler::SetupGraphicsElements()
     zoomShape.setOutlineColor(sf::Color::Green);
     zoomShape.setOutlineThickness(1);
     zoomShape.setFillColor(sf::Color::Transparent);
+
+    progressShape.setFillColor(sf::Color::Green);
+    progressShape.setPosition(sf::Vector2f(0.0f, (float)settings->RegionSize - 6.0f));
     
     this->rasterizationBuffer = new double[settings->RegionSize * settings->RegionSize];
     this->linesBuffer = new double[settings->RegionSize * settings->RegionSize];
+    this->costBuffer = new RasterCost[settings->RegionSize * settings->RegionSize];
+    this->texturePixels.resize(settings->RegionSize * settings->RegionSize * 4); // * 4 because pixels have 4 components (RGBA)
+
+    // The buffers aren't rasterized until the first render completes.
+    std::fill(this->rasterizationBuffer, this->rasterizationBuffer + settings->RegionSize * settings->RegionSize, 0.0);
+    std::fill(this->linesBuffer, this->linesBuffer + settings->RegionSize * settings->RegionSize, 0.0);
 
     rerender = true;
 }
@@ -204,26 +228,87 @@ void ContourTiler::SetupGraphicsElements()
 void ContourTiler::FillOverallTexture()
 {
     // Rasterize
-    rasterizer.Rasterize(leftOffset, topOffset, effectiveSize, &rasterizationBuffer);
+    rasterizer.Rasterize(leftOffset, topOffset, effectiveSize, &rasterizationBuffer, costBuffer);
     rasterizer.LineRaster(leftOffset, topOffset, effectiveSize, &linesBuffer);
+}
 
-    UpdateTextureFromBuffer();
+double ContourTiler::GetHeatmapValue(const RasterCost& cost) const
+{
+    switch (heatmapMode)
+    {
+    case HeatmapRings:
+        return (double)cost.ringsVisited;
+    case HeatmapSegments:
+        // Dense cells test orders of magnitude more segments than sparse ones, so scale logarithmically.
+        return std::log2(1.0 + (double)cost.segmentsTested);
+    case HeatmapSectors:
+        return (double)cost.sectorsFilled;
+    default:
+        return 0.0;
+    }
 }
 
 void ContourTiler::UpdateTextureFromBuffer()
 {
-    // Copy over to the image with an appropriate color mapping.
-    sf::Uint8* pixels = new sf::Uint8[settings->RegionSize * settings->RegionSize * 4]; // * 4 because pixels have 4 components (RGBA)
-    for (int i = 0; i < settings->RegionSize; i++)
+    if (!isLoaded)
+    {
+        TakePreview();
+    }
+
+    finishedColumns.clear();
+    rasterizer.TakeFinishedColumns(finishedColumns);
+
+    // The heatmap is scaled to the most expensive pixel in the view, so it is recolored completely when anything changes.
+    if (isTextureStale || (this->heatmapMode != HeatmapOff && !finishedColumns.empty()))
+    {
+        double maxHeatmapValue = 0.0;
+        if (this->heatmapMode != HeatmapOff)
+        {
+            for (int i = 0; i < settings->RegionSize * settings->RegionSize; i++)
+            {
+                maxHeatmapValue = std::max(maxHeatmapValue, GetHeatmapValue(costBuffer[i]));
+            }
+        }
+
+        isTextureStale = false;
+        UpdateTextureColumns(0, settings->RegionSize, maxHeatmapValue);
+        return;
+    }
+
+    std::sort(finishedColumns.begin(), finishedColumns.end());
+
+    // Upload each run of adjacent columns as a single rectangle.
+    size_t runStart = 0;
+    for (size_t i = 1; i <= finishedColumns.size(); i++)
+    {
+        if (i == finishedColumns.size() || finishedColumns[i] != finishedColumns[i - 1] + 1)
+        {
+            UpdateTextureColumns(finishedColumns[runStart], finishedColumns[i - 1] - finishedColumns[runStart] + 1, 0.0);
+            runStart = i;
+        }
+    }
+}
+
+void ContourTiler::UpdateTextureColumns(int startColumn, int columnCount, double maxHeatmapValue)
+{
+    // Copy over to the image with an appropriate color mapping, packing the columns into a [columnCount]x[RegionSize] image.
+    sf::Uint8* pixels = &texturePixels[0];
+    for (int j = 0; j < settings->RegionSize; j++)
     {
-        for (int j = 0; j < settings->RegionSize; j++)
+        for (int i = startColumn; i < startColumn + columnCount; i++)
         {
             double elevation = rasterizationBuffer[i + j * settings->RegionSize];
-            int pixelIdx = (i + j * settings->RegionSize) * 4;
+            int pixelIdx = ((i - startColumn) + j * columnCount) * 4;
 
-            if (this->renderColors)
+            if (this->heatmapMode != HeatmapOff)
             {
-                colorMapper.MapColor(elevation, &pixels[pixelIdx], &pixels[pixelIdx + 1], &pixels[pixelIdx + 2]);
+                // Cheap pixels are blue, expensive pixels are red.
+                double percent = maxHeatmapValue == 0.0 ? 0.0 : GetHeatmapValue(costBuffer[i + j * settings->RegionSize]) / maxHeatmapValue;
+                colorMapper.LookupColor((1.0 - percent) * 0.66, &pixels[pixelIdx], &pixels[pixelIdx + 1], &pixels[pixelIdx + 2]);
+            }
+            else if (this->renderColors)
+            {
+                colorMapper.LookupColor(elevation, &pixels[pixelIdx], &pixels[pixelIdx + 1], &pixels[pixelIdx + 2]);
             }
             else
             {
@@ -241,13 +326,12 @@ void ContourTiler::UpdateTextureFromBuffer()
                 if (linesBuffer[i + j * settings->RegionSize] < 0.80)
                 {
                     // Overlay blue for direct points
-                    pixels[pixelIdx] = std::min(255, pixels[pixelIdx] + 50);
-                    // pixels[pixelIdx + 1] = std::min(255, pixels[pixelIdx] + 50);
+                    pixels[pixelIdx] = colorMapper.BlendContour(pixels[pixelIdx]);
                 }
                 else
                 {
-                    pixels[pixelIdx] = std::min(255, pixels[pixelIdx] + 50);
-                    pixels[pixelIdx + 1] = std::min(255, pixels[pixelIdx] + 50);
+                    pixels[pixelIdx] = colorMapper.BlendContour(pixels[pixelIdx]);
+                    pixels[pixelIdx + 1] = colorMapper.BlendContour(pixels[pixelIdx]);
                 }
             }
 
@@ -255,14 +339,13 @@ void ContourTiler::UpdateTextureFromBuffer()
         }
     }
 
-    overallTexture.update(pixels);
-    delete[] pixels;
+    overallTexture.update(pixels, columnCount, settings->RegionSize, startColumn, 0);
 }
 
 void ContourTiler::Render(sf::RenderWindow& window, sf::Time elapsedTime)
 {
-    // Rerender as needed on a separate thread.
-    if (rerender && !isRendering)
+    // Rerender as needed on a separate thread, once the index is ready.
+    if (rerender && !isRendering && isLoaded)
     {
         isRendering = true;
         rasterStartTime = elapsedTime;
@@ -275,6 +358,9 @@ void ContourTiler::Render(sf::RenderWindow& window, sf::Time elapsedTime)
         {
             rerender = false;
             isRendering = false;
+
+            // The contour lines are only rasterized once the elevations are done.
+            isTextureStale = true;
             std::cout << "Raster time: " << (elapsedTime - rasterStartTime).asSeconds() << " s." << std::endl;
             if (!this->outputHelp)
             {
@@ -288,62 +374,26 @@ void ContourTiler::Render(sf::RenderWindow& window, sf::Time elapsedTime)
                 if (regionX == 0)
                 {
                     // Base output folder
-                    if (regionY == 0)
+                    if (regionY == 0 && !tileWriter.CreateOutputFolder())
                     {
-                        std::stringstream folder;
-                        folder << ".\\" << settings->OutputFolder.c_str();
-                        if (_mkdir(folder.str().c_str()) != 0)
-                        {
-                            std::cout << "Unable to create directory '" << folder.str().c_str() << "'. This application will not overwrite existing folders or may not have permission." << std::endl;
-                            isBulkProcessing = false;
-                            return;
-                        }
+                        isBulkProcessing = false;
+                        return;
                     }
 
                     // Y-index folders.
-                    std::stringstream folder;
-                    folder << ".\\" << settings->OutputFolder.c_str() << "\\" << regionY;
-                    if (_mkdir(folder.str().c_str()) != 0)
+                    if (!tileWriter.CreateRowFolder(regionY))
                     {
-                        std::cout << "Unable to create directory '" << folder.str().c_str() << "'. This application will not overwrite existing folders or may not have permission." << std::endl;
                         isBulkProcessing = false;
                         return;
                     }
-
-                    std::cout << "Making directory " << folder.str().c_str() << std::endl;
                 }
 
                 // Save out our current data
-                std::stringstream file;
-                file << settings->OutputFolder.c_str() << "/" << regionY << "/" << regionX << ".png";
-
-                unsigned char* data = new unsigned char[settings->RegionSize * settings->RegionSize * 4];
-                for (int i = 0; i < settings->RegionSize; i++)
-                {
-                    for (int j = 0; j < settings->RegionSize; j++)
-                    {
-                        // RGBA order
-                        int scaledVersion = std::min((int)(rasterizationBuffer[i + j * settings->RegionSize] * (65536)), 65535);
-                        // RED == upper 8 bytes.
-                        // GREEN == lower 8 bytes.
-
-                        data[(i + j * settings->RegionSize) * 4] = (unsigned char)(scaledVersion & 0x00FF);
-                        data[(i + j * settings->RegionSize) * 4 + 1] = (unsigned char)((scaledVersion & 0xFF00) >> 8);
-                        data[(i + j * settings->RegionSize) * 4 + 2] = 255;
-                        data[(i + j * settings->RegionSize) * 4 + 3] = 255;
-                    }
-                }
-
-                const int RGBA = 4;
-                std::cout << file.str().c_str() << std::endl;
-                int result = stbi_write_png(file.str().c_str(), settings->RegionSize, settings->RegionSize, RGBA, &data[0], settings->RegionSize * 4 * sizeof(unsigned char));
-                if (result != 0)
+                tileWriter.WriteHeightTile(regionX, regionY, rasterizationBuffer);
+                if (settings->ExportCostMaps)
                 {
-                    std::cout << "  Possible failure writing to file: " << result << " for raster " << regionX << ", " << regionY << std::endl;
+                    tileWriter.WriteCostTile(regionX, regionY, costBuffer);
                 }
-                
-                std::cout << "Wrote the file " << regionX << ", " << regionY << std::endl;
-                delete[] data;
 
                 // Move to the next region.
                 regionX++;
@@ -360,7 +410,10 @@ void ContourTiler::Render(sf::RenderWindow& window, sf::Time elapsedTime)
                 else
                 {
                     isBulkProcessing = false;
-                    std::cout << "Tiling and rasterization done!" << std::endl;
+                    if (tileWriter.Finish())
+                    {
+                        std::cout << "Tiling and rasterization done!" << std::endl;
+                    }
                 }
             }
         }
@@ -377,6 +430,11 @@ void ContourTiler::Render(sf::RenderWindow& window, sf::Time elapsedTime)
     window.clear(sf::Color::Blue);
     window.draw(overallSprite);
 
+    if (!isLoaded)
+    {
+        window.draw(progressShape);
+    }
+
     if (mouseStart.x != -1)
     {
         zoomShape.setPosition(sf::Vector2f((float)mouseStart.x, (float)mouseStart.y));
@@ -386,41 +444,138 @@ void ContourTiler::Render(sf::RenderWindow& window, sf::Time elapsedTime)
     }
 }
 
-void ContourTiler::Run(Settings* settings)
+bool ContourTiler::LoadAndIndex()
 {
-    this->settings = settings;
     // == Load data ==
-    // Load our data file.
-    if (!lineStripLoader.Initialize(settings))
+    // Load our data file, previewing it as each file is read and imported.
+    loadingPreview.reset(new LoadingPreview(settings->RegionSize));
+    bool isInitialized = lineStripLoader.Initialize(settings,
+        [this](const LineStripSet& lineStrips) { PreviewImportedStrips(lineStrips); },
+        [this](const LineStripSet& scannedStrips) { PreviewScannedStrips(scannedStrips); });
+    loadingPreview.reset();
+
+    if (!isInitialized)
     {
-        std::cout << "Could not parse the input GeoJSON files!" << std::endl;
-        return;
+        std::cout << "Could not parse the input files!" << std::endl;
+        return false;
     }
 
     std::cout << std::endl;
     std::cout << "==Initializing Environment==" << std::endl;
+    isIndexing = true;
     rasterizer.Setup(settings);
+    return true;
+}
+
+void ContourTiler::PreviewScannedStrips(const LineStripSet& scannedStrips)
+{
+    std::vector<double> preview(settings->RegionSize * settings->RegionSize, 0.0);
+    LoadingPreview::DrawLines(scannedStrips, leftOffset, topOffset, effectiveSize, settings->RegionSize, preview.data());
+    PublishPreview(preview);
+}
+
+void ContourTiler::PreviewImportedStrips(const LineStripSet& lineStrips)
+{
+    // Only the new strips are indexed, and only every few pixels are searched, so this is quick compared to importing a file.
+    loadingPreview->AddLineStrips(lineStrips);
+
+    std::vector<double> preview(settings->RegionSize * settings->RegionSize, 0.0);
+    loadingPreview->Rasterize(leftOffset, topOffset, effectiveSize, std::max(1, settings->RegionSize / PreviewResolution), preview.data());
+    PublishPreview(preview);
+}
+
+void ContourTiler::PublishPreview(std::vector<double>& preview)
+{
+    std::lock_guard<std::mutex> lock(previewMutex);
+    previewBuffer.swap(preview);
+    isPreviewReady = true;
+}
+
+void ContourTiler::TakePreview()
+{
+    std::lock_guard<std::mutex> lock(previewMutex);
+    if (isPreviewReady)
+    {
+        std::copy(previewBuffer.begin(), previewBuffer.end(), rasterizationBuffer);
+        isPreviewReady = false;
+        isTextureStale = true;
+    }
+}
+
+bool ContourTiler::UpdateLoadingProgress(sf::RenderWindow& window)
+{
+    if (loadingThread.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        if (!loadingThread.get())
+        {
+            return false;
+        }
+
+        isLoaded = true;
+        windowTitle = "Contour Tiler";
+        window.setTitle(windowTitle);
+        return true;
+    }
+
+    std::string stage = "Indexing contours";
+    double fraction = 1.0;
+    if (!isIndexing)
+    {
+        lineStripLoader.GetProgress(&stage, &fraction);
+    }
+
+    std::stringstream title;
+    title << "Contour Tiler - " << stage << " (" << (int)(fraction * 100) << "%)";
+    if (title.str() != windowTitle)
+    {
+        windowTitle = title.str();
+        window.setTitle(windowTitle);
+    }
+
+    progressShape.setSize(sf::Vector2f((float)(fraction * (double)settings->RegionSize), 6.0f));
+    return true;
+}
+
+void ContourTiler::Run(Settings* settings)
+{
+    this->settings = settings;
+    this->tileWriter.Setup(settings);
 
     // == Setup graphics ==
     // 24 depth bits, 8 stencil bits, 8x AA, major version 4.
     sf::ContextSettings contextSettings = sf::ContextSettings(24, 8, 8, 4, 0);
 
     sf::Uint32 style =  sf::Style::Titlebar | sf::Style::Close;
-    sf::RenderWindow window(sf::VideoMode(settings->RegionSize, settings->RegionSize), "Contour Tiler", style, contextSettings);
+    windowTitle = "Contour Tiler";
+    sf::RenderWindow window(sf::VideoMode(settings->RegionSize, settings->RegionSize), windowTitle, style, contextSettings);
     window.setFramerateLimit(60);
 
     this->SetupGraphicsElements();
 
+    // The window is usable while the contours load, showing each file as it is imported.
+    loadingThread = std::async(std::launch::async, &ContourTiler::LoadAndIndex, this);
+
     // == Start the main loop ==
     bool alive = true;
     sf::Clock timer;
     this->lastUpdateTime = timer.getElapsedTime();
     while (alive)
     {
+        if (!isLoaded && !UpdateLoadingProgress(window))
+        {
+            break;
+        }
+
         HandleEvents(window, alive);
         Render(window, timer.getElapsedTime());
         window.display();
     }
+
+    // Loading can't be interrupted, so wait for it to end before the data it uses is destroyed.
+    if (loadingThread.valid())
+    {
+        loadingThread.wait();
+    }
 }
 
 // Performs the graphical interpolation and tiling of contours.
@@ -1,21 +1,37 @@
 #pragma once
-#include <SFML\System.hpp>
-#include <SFML\Graphics.hpp>
+#include <SFML/System.hpp>
+#include <SFML/Graphics.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <future>
 #include <string>
 #include "ColorMapper.h"
 #include "LineStripLoader.h"
+#include "LoadingPreview.h"
 #include "Rasterizer.h"
 #include "Settings.h"
+#include "TileWriter.h"
 
 // Handles startup and the base graphics rendering loop.
 class ContourTiler
 {
     Settings* settings;
 
+    // Per-pixel search cost overlays, cycled with 'H'.
+    enum HeatmapMode
+    {
+        HeatmapOff,
+        HeatmapRings,
+        HeatmapSegments,
+        HeatmapSectors,
+        HeatmapModeCount
+    };
+
     bool renderColors;
     bool renderContours;
+    int heatmapMode;
 
     bool rerender;
     sf::Vector2i mouseStart;
@@ -33,7 +49,47 @@ class ContourTiler
     sf::Time rasterStartTime;
     LineStripLoader lineStripLoader;
 
+    // Loading and indexing run in the background, so the window opens immediately.
+    std::future<bool> loadingThread;
+    std::atomic<bool> isLoaded;
+    std::atomic<bool> isIndexing;
+    std::string windowTitle;
+    sf::RectangleShape progressShape;
+
+    // Loads the contours and builds the index, returning false if the inputs couldn't be loaded.
+    bool LoadAndIndex();
+
+    // While loading, the view is previewed with about this many samples per side.
+    static const int PreviewResolution = 128;
+
+    // Grid over the contours imported so far, only used by the loading thread.
+    std::unique_ptr<LoadingPreview> loadingPreview;
+
+    // Previews are drawn by the loading thread and handed to the display thread, which owns the rasterization buffer until loading is done.
+    std::mutex previewMutex;
+    std::vector<double> previewBuffer;
+    bool isPreviewReady;
+
+    // Draws the contours read so far while finding the boundaries, so the data appears before it is imported.
+    void PreviewScannedStrips(const LineStripSet& scannedStrips);
+
+    // Adds the contours imported since the last preview to the grid and rasterizes the view from it.
+    void PreviewImportedStrips(const LineStripSet& lineStrips);
+
+    // Hands a finished preview to the display thread.
+    void PublishPreview(std::vector<double>& preview);
+
+    // Copies the latest preview into the rasterization buffer, if there is a new one.
+    void TakePreview();
+
+    // Shows the loading stage in the title and returns false if loading failed.
+    bool UpdateLoadingProgress(sf::RenderWindow& window);
+
     double* linesBuffer;
+    RasterCost* costBuffer;
+
+    // Returns the value of the current heatmap overlay for the given pixel cost.
+    double GetHeatmapValue(const RasterCost& cost) const;
 
     bool isZoomMode;
     ColorMapper colorMapper;
@@ -41,13 +97,25 @@ class ContourTiler
     
     sf::Texture overallTexture;
     sf::Sprite overallSprite;
+
+    // Colored pixels of the columns being uploaded, kept between updates to avoid reallocating.
+    std::vector<sf::Uint8> texturePixels;
+    std::vector<int> finishedColumns;
+
+    // Set when the whole texture must be recolored, such as when the display mode or contour lines change.
+    std::atomic<bool> isTextureStale;
+
     void SetupGraphicsElements();
     void FillOverallTexture();
+
+    // Recolors and uploads the columns finished since the last update, or everything if the texture is stale.
     void UpdateTextureFromBuffer();
+    void UpdateTextureColumns(int startColumn, int columnCount, double maxHeatmapValue);
 
     int regionX, regionY;
     void ZoomToRegion(int x, int y);
     bool isBulkProcessing;
+    TileWriter tileWriter;
     sf::Time regionStartTime;
 
     bool outputHelp;
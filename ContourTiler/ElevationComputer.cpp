@@ -1,10 +1,11 @@
 #define _USE_MATH_DEFINES
+#include <algorithm>
 #include <cmath>
 #include <limits>
 #include "ElevationComputer.h"
 
 ElevationComputer::ElevationComputer(Point point)
-    : point(point)
+    : point(point), lowResPoint((float)point.x, (float)point.y)
 {
     for (int i = 0; i < MaxRegions; i++)
     {
@@ -56,13 +57,53 @@ void ElevationComputer::ProcessLine(Point start, Point end, double elevation)
     Point closestPoint = Point();
     ElevationComputer::GetClosestPointOnLine(this->point, start, end, &closestPoint);
     double angle = ElevationComputer::ComputeAngle(point, closestPoint);
+    double distanceSqd = pow(closestPoint.x - point.x, 2) + pow(closestPoint.y - point.y, 2);
+    UpdateRegion(angle, distanceSqd, elevation);
+}
+
+void ElevationComputer::ProcessLine(LowResPoint start, LowResPoint end, double elevation)
+{
+    // As above, but relative to the point so that the offsets keep their precision.
+    float startX = start.x - lowResPoint.x;
+    float startY = start.y - lowResPoint.y;
+    float startToEndX = end.x - start.x;
+    float startToEndY = end.y - start.y;
+    float projectionFraction = -(startX * startToEndX + startY * startToEndY) / (startToEndX * startToEndX + startToEndY * startToEndY);
+
+    float closestX, closestY;
+    if (projectionFraction > 0 && projectionFraction < 1)
+    {
+        closestX = startX + startToEndX * projectionFraction;
+        closestY = startY + startToEndY * projectionFraction;
+    }
+    else if (projectionFraction < 0)
+    {
+        closestX = startX;
+        closestY = startY;
+    }
+    else
+    {
+        closestX = end.x - lowResPoint.x;
+        closestY = end.y - lowResPoint.y;
+    }
+
+    float angle = std::atan2(closestY, closestX);
+    if (angle < 0)
+    {
+        angle += (float)(2 * M_PI);
+    }
+
+    UpdateRegion((double)angle, (double)(closestX * closestX + closestY * closestY), elevation);
+}
+
+void ElevationComputer::UpdateRegion(double angle, double distanceSqd, double elevation)
+{
     int quadrant = (int)(((double)MaxRegions * angle) / (2.0 * M_PI));
     if (quadrant >= MaxRegions)
     {
         quadrant = MaxRegions - 1;
     }
 
-    double distanceSqd = pow(closestPoint.x - point.x, 2) + pow(closestPoint.y - point.y, 2);
     if (!lineRegions[quadrant].IsPopulated)
     {
         lineRegions[quadrant].IsPopulated = true;
@@ -80,6 +121,41 @@ void ElevationComputer::ProcessLine(Point start, Point end, double elevation)
     }
 }
 
+bool ElevationComputer::CanImprove(double startAngle, double endAngle, double distanceSqd) const
+{
+    // Sectors are found as in ProcessLine, wrapping around past 2 pi.
+    int startQuadrant = (int)std::floor(((double)MaxRegions * startAngle) / (2.0 * M_PI));
+    int endQuadrant = (int)std::floor(((double)MaxRegions * endAngle) / (2.0 * M_PI));
+    if (endQuadrant < startQuadrant)
+    {
+        endQuadrant += MaxRegions;
+    }
+
+    for (int i = startQuadrant; i <= endQuadrant && i < startQuadrant + MaxRegions; i++)
+    {
+        const DistanceElevation& region = lineRegions[((i % MaxRegions) + MaxRegions) % MaxRegions];
+        if (!region.IsPopulated || region.DistanceSqd > distanceSqd)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ElevationComputer::CanImprove(double distanceSqd) const
+{
+    for (int i = 0; i < MaxRegions; i++)
+    {
+        if (!lineRegions[i].IsPopulated || lineRegions[i].DistanceSqd > distanceSqd)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 bool ElevationComputer::HasSufficientData() const
 {
     // If two opposing quadrants are covered, we're done.
@@ -96,6 +172,34 @@ bool ElevationComputer::HasSufficientData() const
     return true;
 }
 
+int ElevationComputer::PopulatedRegionCount() const
+{
+    int populatedRegions = 0;
+    for (int i = 0; i < MaxRegions; i++)
+    {
+        if (lineRegions[i].IsPopulated)
+        {
+            ++populatedRegions;
+        }
+    }
+
+    return populatedRegions;
+}
+
+double ElevationComputer::GetNearestDistanceSqd() const
+{
+    double nearestDistanceSqd = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < MaxRegions; i++)
+    {
+        if (lineRegions[i].IsPopulated)
+        {
+            nearestDistanceSqd = std::min(nearestDistanceSqd, lineRegions[i].DistanceSqd);
+        }
+    }
+
+    return nearestDistanceSqd;
+}
+
 double ElevationComputer::GetWeightedElevation() const
 {
     // Weight each elevation by its distance squared.
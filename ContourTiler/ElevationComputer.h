@@ -16,8 +16,14 @@ class ElevationComputer
     static const int MaxRegions = 10;
 
     Point point;
+
+    // The point rounded to the precision of low resolution lines, which are processed relative to it.
+    LowResPoint lowResPoint;
     
     DistanceElevation lineRegions[MaxRegions];
+
+    // Keeps the line if it is the closest in the sector at the angle.
+    void UpdateRegion(double angle, double distanceSqd, double elevation);
 public:
     ElevationComputer(Point point);
 
@@ -25,6 +31,25 @@ public:
     static double ComputeAngle(Point point, Point otherPoint);
 
     void ProcessLine(Point start, Point end, double elevation);
+
+    // Computes in single precision, as low resolution lines only have that precision to begin with.
+    void ProcessLine(LowResPoint start, LowResPoint end, double elevation);
+
+    template <typename T>
+    void ProcessLine(const T& start, const T& end, double elevation)
+    {
+        ProcessLine(ToPoint(start), ToPoint(end), elevation);
+    }
+
+    // Returns true if a line this far away, in the angles from startAngle counter-clockwise to endAngle, could change a sector.
+    bool CanImprove(double startAngle, double endAngle, double distanceSqd) const;
+
+    // Returns true if a line this far away, in any direction, could change a sector.
+    bool CanImprove(double distanceSqd) const;
     bool HasSufficientData() const;
+    int PopulatedRegionCount() const;
+
+    // Returns the squared distance to the nearest line found, or infinity if none were.
+    double GetNearestDistanceSqd() const;
     double GetWeightedElevation() const;
 };
\ No newline at end of file
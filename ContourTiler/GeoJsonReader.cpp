@@ -0,0 +1,640 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "GeoJsonReader.h"
+#include "MappedFile.h"
+
+static inline void SkipWhitespace(const char*& position, const char* end)
+{
+    while (position != end && (*position == ' ' || *position == '\n' || *position == '\r' || *position == '\t'))
+    {
+        ++position;
+    }
+}
+
+// Skips whitespace and the expected character, returning false if a different character is found.
+static inline bool Expect(const char*& position, const char* end, char expected)
+{
+    SkipWhitespace(position, end);
+    if (position == end || *position != expected)
+    {
+        return false;
+    }
+
+    ++position;
+    return true;
+}
+
+GeoJsonReader::GeoJsonReader(std::string elevationFeature)
+    : elevationFeature(elevationFeature)
+{ }
+
+bool GeoJsonReader::ParseNumber(const char*& position, const char* end, double* value)
+{
+    // Powers of ten that are exactly representable as doubles.
+    static const double exactPowers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    const char* start = position;
+    bool isNegative = position != end && *position == '-';
+    if (isNegative)
+    {
+        ++position;
+    }
+
+    // Accumulate up to 19 significant digits, which always fit in 64 bits.
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool hasDigits = false;
+    while (position != end && *position >= '0' && *position <= '9')
+    {
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + (uint64_t)(*position - '0');
+            digits += (mantissa != 0) ? 1 : 0;
+        }
+        else
+        {
+            ++exponent;
+        }
+
+        hasDigits = true;
+        ++position;
+    }
+
+    if (position != end && *position == '.')
+    {
+        ++position;
+        while (position != end && *position >= '0' && *position <= '9')
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (uint64_t)(*position - '0');
+                digits += (mantissa != 0) ? 1 : 0;
+                --exponent;
+            }
+
+            hasDigits = true;
+            ++position;
+        }
+    }
+
+    if (!hasDigits)
+    {
+        position = start;
+        return false;
+    }
+
+    bool isTruncated = digits >= 19 && position != end;
+    if (position != end && (*position == 'e' || *position == 'E'))
+    {
+        ++position;
+        bool isExponentNegative = position != end && *position == '-';
+        if (position != end && (*position == '-' || *position == '+'))
+        {
+            ++position;
+        }
+
+        int explicitExponent = 0;
+        bool hasExponentDigits = false;
+        while (position != end && *position >= '0' && *position <= '9')
+        {
+            explicitExponent = std::min(explicitExponent * 10 + (*position - '0'), 100000);
+            hasExponentDigits = true;
+            ++position;
+        }
+
+        if (!hasExponentDigits)
+        {
+            position = start;
+            return false;
+        }
+
+        exponent += isExponentNegative ? -explicitExponent : explicitExponent;
+    }
+
+    // Clinger's fast path: both the mantissa and the power of ten are exact, so a single multiply or divide rounds correctly.
+    // Contour coordinates almost always take this path. Anything else is left to strtod, which is slower but also exact.
+    if (!isTruncated && mantissa <= ((uint64_t)1 << 53) && exponent >= -22 && exponent <= 22)
+    {
+        double result = (double)mantissa;
+        result = exponent < 0 ? result / exactPowers[-exponent] : result * exactPowers[exponent];
+        *value = isNegative ? -result : result;
+        return true;
+    }
+
+    std::string text(start, position);
+    *value = std::strtod(text.c_str(), nullptr);
+    return true;
+}
+
+bool GeoJsonReader::ParseString(const char*& position, const char* end, std::string* result)
+{
+    while (position != end)
+    {
+        char character = *position++;
+        if (character == '"')
+        {
+            return true;
+        }
+
+        if (character != '\\')
+        {
+            if (result != nullptr)
+            {
+                result->push_back(character);
+            }
+
+            continue;
+        }
+
+        if (position == end)
+        {
+            return false;
+        }
+
+        char escaped = *position++;
+        if (escaped == 'u')
+        {
+            if (end - position < 4)
+            {
+                return false;
+            }
+
+            unsigned int codePoint = (unsigned int)std::strtoul(std::string(position, position + 4).c_str(), nullptr, 16);
+            position += 4;
+            if (result != nullptr)
+            {
+                // Property names are compared as UTF-8. Surrogate pairs are passed through as separate code points.
+                if (codePoint < 0x80)
+                {
+                    result->push_back((char)codePoint);
+                }
+                else if (codePoint < 0x800)
+                {
+                    result->push_back((char)(0xC0 | (codePoint >> 6)));
+                    result->push_back((char)(0x80 | (codePoint & 0x3F)));
+                }
+                else
+                {
+                    result->push_back((char)(0xE0 | (codePoint >> 12)));
+                    result->push_back((char)(0x80 | ((codePoint >> 6) & 0x3F)));
+                    result->push_back((char)(0x80 | (codePoint & 0x3F)));
+                }
+            }
+        }
+        else if (result != nullptr)
+        {
+            const char* escapes = "b\bf\fn\nr\rt\t";
+            const char* match = std::strchr(escapes, escaped);
+            result->push_back(match != nullptr && (match - escapes) % 2 == 0 ? match[1] : escaped);
+        }
+    }
+
+    return false;
+}
+
+bool GeoJsonReader::SkipValue(const char*& position, const char* end)
+{
+    SkipWhitespace(position, end);
+    if (position == end)
+    {
+        return false;
+    }
+
+    if (*position == '"')
+    {
+        ++position;
+        return ParseString(position, end, nullptr);
+    }
+
+    if (*position != '{' && *position != '[')
+    {
+        // Numbers and literals run until the next delimiter.
+        const char* start = position;
+        while (position != end && *position != ',' && *position != '}' && *position != ']' &&
+            *position != ' ' && *position != '\n' && *position != '\r' && *position != '\t')
+        {
+            ++position;
+        }
+
+        return position != start;
+    }
+
+    // Objects and arrays only need their nesting tracked, skipping over strings that may hold brackets.
+    int depth = 0;
+    while (position != end)
+    {
+        char character = *position++;
+        if (character == '"')
+        {
+            if (!ParseString(position, end, nullptr))
+            {
+                return false;
+            }
+        }
+        else if (character == '{' || character == '[')
+        {
+            ++depth;
+        }
+        else if (character == '}' || character == ']')
+        {
+            if (--depth == 0)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+const char* GeoJsonReader::GetTypeName(char firstCharacter)
+{
+    switch (firstCharacter)
+    {
+    case '"':
+        return "string";
+    case '{':
+        return "object";
+    case '[':
+        return "array";
+    case 't':
+    case 'f':
+        return "boolean";
+    case 'n':
+        return "null";
+    default:
+        return "unknown";
+    }
+}
+
+bool GeoJsonReader::ParseCoordinates(const char*& position, const char* end, Chunk& chunk) const
+{
+    // MultiLineString coordinates: an array of line sets, each an array of [x, y] or [x, y, z] positions.
+    if (!Expect(position, end, '['))
+    {
+        return false;
+    }
+
+    SkipWhitespace(position, end);
+    if (position != end && *position == ']')
+    {
+        ++position;
+        return true;
+    }
+
+    do
+    {
+        if (!Expect(position, end, '['))
+        {
+            return false;
+        }
+
+        SkipWhitespace(position, end);
+        if (position != end && *position == ']')
+        {
+            ++position;
+        }
+        else
+        {
+            do
+            {
+                Point point;
+                if (!Expect(position, end, '['))
+                {
+                    return false;
+                }
+
+                SkipWhitespace(position, end);
+                if (!ParseNumber(position, end, &point.x) || !Expect(position, end, ','))
+                {
+                    return false;
+                }
+
+                SkipWhitespace(position, end);
+                if (!ParseNumber(position, end, &point.y))
+                {
+                    return false;
+                }
+
+                // Ignore any altitude.
+                SkipWhitespace(position, end);
+                while (position != end && *position == ',')
+                {
+                    ++position;
+                    if (!SkipValue(position, end))
+                    {
+                        return false;
+                    }
+
+                    SkipWhitespace(position, end);
+                }
+
+                if (!Expect(position, end, ']'))
+                {
+                    return false;
+                }
+
+                chunk.points.push_back(point);
+                SkipWhitespace(position, end);
+            }
+            while (position != end && *position++ == ',');
+
+            if (position[-1] != ']')
+            {
+                return false;
+            }
+        }
+
+        chunk.lineSetPointEnds.push_back(chunk.points.size());
+        SkipWhitespace(position, end);
+    }
+    while (position != end && *position++ == ',');
+
+    return position[-1] == ']';
+}
+
+bool GeoJsonReader::ParseFeature(const char*& position, const char* end, Chunk& chunk) const
+{
+    bool hasElevation = false;
+    double elevation = 0.0;
+    if (!Expect(position, end, '{'))
+    {
+        return false;
+    }
+
+    SkipWhitespace(position, end);
+    if (position != end && *position == '}')
+    {
+        ++position;
+    }
+    else
+    {
+        std::string key;
+        do
+        {
+            key.clear();
+            if (!Expect(position, end, '"') || !ParseString(position, end, &key) || !Expect(position, end, ':'))
+            {
+                return false;
+            }
+
+            SkipWhitespace(position, end);
+            if ((key == "properties" || key == "geometry") && position != end && *position == '{')
+            {
+                bool isProperties = key == "properties";
+                ++position;
+                SkipWhitespace(position, end);
+                if (position != end && *position == '}')
+                {
+                    ++position;
+                }
+                else
+                {
+                    do
+                    {
+                        key.clear();
+                        if (!Expect(position, end, '"') || !ParseString(position, end, &key) || !Expect(position, end, ':'))
+                        {
+                            return false;
+                        }
+
+                        SkipWhitespace(position, end);
+                        if (isProperties && key == elevationFeature)
+                        {
+                            if (position == end || !ParseNumber(position, end, &elevation))
+                            {
+                                chunk.error = std::string("The given elevation property was not an integer or a floating point value, but a '") +
+                                    GetTypeName(position == end ? ' ' : *position) + "'. Only these two value types are supported.";
+                                return false;
+                            }
+
+                            hasElevation = true;
+                        }
+                        else if (!isProperties && key == "coordinates")
+                        {
+                            if (!ParseCoordinates(position, end, chunk))
+                            {
+                                return false;
+                            }
+                        }
+                        else if (!SkipValue(position, end))
+                        {
+                            return false;
+                        }
+
+                        SkipWhitespace(position, end);
+                    }
+                    while (position != end && *position++ == ',');
+
+                    if (position[-1] != '}')
+                    {
+                        return false;
+                    }
+                }
+            }
+            else if (!SkipValue(position, end))
+            {
+                return false;
+            }
+
+            SkipWhitespace(position, end);
+        }
+        while (position != end && *position++ == ',');
+
+        if (position[-1] != '}')
+        {
+            return false;
+        }
+    }
+
+    if (!hasElevation)
+    {
+        chunk.error = "Could not find the property '" + elevationFeature + "' in the list of known properties for a feature!";
+        return false;
+    }
+
+    chunk.elevations.push_back(elevation);
+    chunk.featureLineSetEnds.push_back(chunk.lineSetPointEnds.size());
+    return true;
+}
+
+void GeoJsonReader::ParseChunk(Chunk* chunk) const
+{
+    // The chunk holds whole features, separated by commas.
+    const char* position = chunk->start;
+    while (true)
+    {
+        if (!ParseFeature(position, chunk->end, *chunk))
+        {
+            if (chunk->error.empty())
+            {
+                chunk->error = "The features could not be parsed.";
+            }
+
+            chunk->errorOffset = position - chunk->start;
+            return;
+        }
+
+        if (!Expect(position, chunk->end, ','))
+        {
+            break;
+        }
+    }
+
+    // The points no longer move, so the line sets can point to them.
+    size_t pointStart = 0;
+    for (size_t pointEnd : chunk->lineSetPointEnds)
+    {
+        ContourLineSet lineSet;
+        lineSet.points = chunk->points.data() + pointStart;
+        lineSet.count = pointEnd - pointStart;
+        chunk->lineSets.push_back(lineSet);
+        pointStart = pointEnd;
+    }
+}
+
+bool GeoJsonReader::Read(const std::string& file, std::function<bool(const ContourFeature&)> onFeature) const
+{
+    MappedFile mappedFile;
+    if (!mappedFile.Open(file))
+    {
+        std::cout << "Could not open the file to read contours from: " << file << std::endl;
+        return false;
+    }
+
+    const char* begin = mappedFile.Data();
+    const char* end = begin + mappedFile.Size();
+
+    // Find the features array of the top-level object.
+    const char* position = begin;
+    bool hasFeatures = false;
+    if (Expect(position, end, '{'))
+    {
+        std::string key;
+        do
+        {
+            key.clear();
+            if (!Expect(position, end, '"') || !ParseString(position, end, &key) || !Expect(position, end, ':'))
+            {
+                break;
+            }
+
+            if (key == "features")
+            {
+                hasFeatures = Expect(position, end, '[');
+                break;
+            }
+
+            if (!SkipValue(position, end))
+            {
+                break;
+            }
+
+            SkipWhitespace(position, end);
+        }
+        while (position != end && *position++ == ',');
+    }
+
+    if (!hasFeatures)
+    {
+        std::cout << "The file '" << file << "' is not a GeoJSON feature collection." << std::endl;
+        return false;
+    }
+
+    // Split the features into chunks of about ChunkSize at feature boundaries. Finding the boundaries only tracks nesting, which is much faster than parsing.
+    std::vector<const char*> chunkStarts;
+    SkipWhitespace(position, end);
+    if (position != end && *position == ']')
+    {
+        return true;
+    }
+
+    chunkStarts.push_back(position);
+    const char* featuresEnd = nullptr;
+    while (position != end)
+    {
+        if (!SkipValue(position, end))
+        {
+            break;
+        }
+
+        SkipWhitespace(position, end);
+        if (position != end && *position == ']')
+        {
+            featuresEnd = position;
+            break;
+        }
+
+        if (position == end || *position != ',')
+        {
+            break;
+        }
+
+        ++position;
+        if ((size_t)(position - chunkStarts.back()) >= ChunkSize)
+        {
+            chunkStarts.push_back(position);
+        }
+    }
+
+    if (featuresEnd == nullptr)
+    {
+        std::cout << "Unable to parse the features of '" << file << "' near byte " << (position - begin) << "." << std::endl;
+        return false;
+    }
+
+    // Parse a batch of chunks at a time on all cores, then pass on their features in order.
+    unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t batchStart = 0; batchStart < chunkStarts.size(); batchStart += threadCount)
+    {
+        size_t batchEnd = std::min(batchStart + threadCount, chunkStarts.size());
+        std::vector<Chunk> chunks(batchEnd - batchStart);
+        std::vector<std::thread> threads;
+        for (size_t i = batchStart; i < batchEnd; i++)
+        {
+            Chunk& chunk = chunks[i - batchStart];
+            chunk.start = chunkStarts[i];
+
+            // Chunks end at the comma before the next chunk, which the parser stops at.
+            chunk.end = i + 1 < chunkStarts.size() ? chunkStarts[i + 1] - 1 : featuresEnd;
+            chunk.errorOffset = 0;
+            threads.push_back(std::thread(&GeoJsonReader::ParseChunk, this, &chunk));
+        }
+
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        for (Chunk& chunk : chunks)
+        {
+            if (!chunk.error.empty())
+            {
+                std::cout << "Unable to read '" << file << "' near byte " << ((chunk.start - begin) + chunk.errorOffset) << ": " << chunk.error << std::endl;
+                return false;
+            }
+
+            size_t lineSetStart = 0;
+            for (size_t i = 0; i < chunk.elevations.size(); i++)
+            {
+                ContourFeature feature;
+                feature.elevation = chunk.elevations[i];
+                feature.lineSets = chunk.lineSets.data() + lineSetStart;
+                feature.lineSetCount = chunk.featureLineSetEnds[i] - lineSetStart;
+                lineSetStart = chunk.featureLineSetEnds[i];
+                if (!onFeature(feature))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
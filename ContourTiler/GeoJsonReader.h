@@ -0,0 +1,54 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+#include "ContourFeature.h"
+
+// Reads the contour features of a GeoJSON file, splitting the features into ranges that are parsed on all cores.
+// Only the elevation property and the geometry coordinates are parsed, everything else is skipped over.
+class GeoJsonReader
+{
+    // The parsed features of a range of the features array.
+    struct Chunk
+    {
+        const char* start;
+        const char* end;
+
+        std::vector<double> elevations;
+        std::vector<size_t> featureLineSetEnds;
+        std::vector<size_t> lineSetPointEnds;
+        std::vector<Point> points;
+        std::vector<ContourLineSet> lineSets;
+
+        // Empty if the range parsed successfully.
+        std::string error;
+        size_t errorOffset;
+    };
+
+    // Text of chunks parsed at a time, balancing the parse parallelism with the memory used by parsed points.
+    static const size_t ChunkSize = 8 * 1024 * 1024;
+
+    std::string elevationFeature;
+
+    // Converts decimal text to the nearest double, exactly. Returns false if the text isn't a JSON number.
+    static bool ParseNumber(const char*& position, const char* end, double* value);
+
+    // Parses a string (after its opening quote), decoding escapes if a result is provided.
+    static bool ParseString(const char*& position, const char* end, std::string* result);
+
+    // Skips over a value of any type, returning false if it is malformed.
+    static bool SkipValue(const char*& position, const char* end);
+
+    static const char* GetTypeName(char firstCharacter);
+
+    bool ParseFeature(const char*& position, const char* end, Chunk& chunk) const;
+    bool ParseCoordinates(const char*& position, const char* end, Chunk& chunk) const;
+    void ParseChunk(Chunk* chunk) const;
+
+public:
+    GeoJsonReader(std::string elevationFeature);
+
+    // Reads the file, calling the callback with each feature in file order. The feature is only valid during the callback.
+    // Returns false, printing why, if the file can't be read or parsed or if the callback returns false.
+    bool Read(const std::string& file, std::function<bool(const ContourFeature&)> onFeature) const;
+};
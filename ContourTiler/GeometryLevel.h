@@ -0,0 +1,20 @@
+#pragma once
+#include <memory>
+#include "LineStripSet.h"
+#include "SegmentIndex.h"
+
+// Line strips and their lookup index at a single level of detail.
+struct GeometryLevel
+{
+    // Maximum distance (in normalized units) the strips deviate from the loaded strips. Zero at full detail.
+    double tolerance;
+
+    // Points to the loaded strips at full detail or to the simplified copy owned by this level.
+    LineStripSet* lineStrips;
+    LineStripSet simplifiedLineStrips;
+
+    std::unique_ptr<SegmentIndex> index;
+
+    GeometryLevel() : tolerance(0.0), lineStrips(nullptr)
+    { }
+};
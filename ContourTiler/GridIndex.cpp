@@ -0,0 +1,294 @@
+#include <iostream>
+#include <thread>
+#include <utility>
+#include "GridIndex.h"
+#include "LineSimplifier.h"
+
+const size_t GridIndex::DefaultMaxCountEntries;
+
+GridIndex::GridIndex(int size, size_t maxCountEntries)
+    : size(size), quadtree(), lineStrips(nullptr), maxCountEntries(maxCountEntries), searchLines(&GridIndex::SearchLines<Point>)
+{ }
+
+double GridIndex::GetSquareBytes(int size)
+{
+    // The entry offsets of each square, plus the occupancy sums and distances.
+    double quadCount = (double)size * (double)size;
+    return (quadCount + 1.0) * (double)sizeof(size_t) + ((double)(size + 1) * (double)(size + 1) + quadCount) * (double)sizeof(int);
+}
+
+double GridIndex::GetBuildBytes(int size, size_t maxCountEntries)
+{
+    // The counts of at least one range of strips are held, however large the grid.
+    double quadCount = (double)size * (double)size;
+    return std::max(quadCount, (double)maxCountEntries) * (double)sizeof(size_t);
+}
+
+void GridIndex::CountQuadEntries(size_t startStrip, size_t endStrip, size_t* quadCounts) const
+{
+    auto countEntry = [this, quadCounts](GridPoint quad, Index)
+    {
+        if (IsInGrid(quad))
+        {
+            ++quadCounts[quad.x + size * quad.y];
+        }
+    };
+
+    VisitStripQuads(startStrip, endStrip, countEntry);
+}
+
+void GridIndex::PlaceQuadEntries(size_t startStrip, size_t endStrip, size_t* quadOffsets, Index* indexes) const
+{
+    auto placeEntry = [this, quadOffsets, indexes](GridPoint quad, Index index)
+    {
+        if (IsInGrid(quad))
+        {
+            indexes[quadOffsets[quad.x + size * quad.y]++] = index;
+        }
+    };
+
+    VisitStripQuads(startStrip, endStrip, placeEntry);
+}
+
+void GridIndex::ChooseSearchFunction()
+{
+    switch (lineStrips->GetPointType())
+    {
+    case LineStripSet::PointType::Quantized:
+        searchLines = &GridIndex::SearchLines<QuantizedPoint>;
+        break;
+    case LineStripSet::PointType::LowRes:
+        searchLines = &GridIndex::SearchLines<LowResPoint>;
+        break;
+    default:
+        searchLines = &GridIndex::SearchLines<Point>;
+        break;
+    }
+}
+
+void GridIndex::Build(const LineStripSet* lineStrips)
+{
+    this->lineStrips = lineStrips;
+    quadtree.InitializeQuadtree(this->size);
+    ChooseSearchFunction();
+
+    // Each thread counts the entries of each square for a contiguous range of strips, which are then placed in strip order.
+    // Squares list their entries in the same order for any number of threads, so the output doesn't change with the machine.
+    const size_t quadCount = (size_t)size * (size_t)size;
+    size_t rangeCount = std::max((size_t)1, std::min((size_t)std::max(1u, std::thread::hardware_concurrency()), maxCountEntries / quadCount));
+    std::cout << "  Populating with " << lineStrips->strips.size() << " line strips on " << rangeCount << " threads..." << std::endl;
+
+    // Split the strips into ranges with about the same number of segments.
+    size_t segmentCount = LineSimplifier::CountSegments(*lineStrips);
+    std::vector<size_t> rangeStarts(1, 0);
+    size_t rangeSegments = 0;
+    for (size_t i = 0; i < lineStrips->strips.size() && rangeStarts.size() < rangeCount; i++)
+    {
+        rangeSegments += lineStrips->strips[i].count > 1 ? lineStrips->strips[i].count - 1 : 0;
+        if (rangeSegments * rangeCount >= segmentCount * rangeStarts.size())
+        {
+            rangeStarts.push_back(i + 1);
+        }
+    }
+
+    rangeStarts.push_back(lineStrips->strips.size());
+    rangeCount = rangeStarts.size() - 1;
+
+    std::vector<size_t> rangeQuadCounts(rangeCount * quadCount, 0);
+    std::vector<std::thread> threads;
+    for (size_t range = 0; range < rangeCount; range++)
+    {
+        threads.push_back(std::thread(&GridIndex::CountQuadEntries, this, rangeStarts[range], rangeStarts[range + 1], &rangeQuadCounts[range * quadCount]));
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    // Prefix sum over the squares, and over the ranges within each square, turning the counts into where each range places its entries.
+    std::vector<size_t> quadOffsets(quadCount + 1, 0);
+    size_t entryCount = 0;
+    for (size_t quad = 0; quad < quadCount; quad++)
+    {
+        quadOffsets[quad] = entryCount;
+        for (size_t range = 0; range < rangeCount; range++)
+        {
+            size_t rangeEntries = rangeQuadCounts[range * quadCount + quad];
+            rangeQuadCounts[range * quadCount + quad] = entryCount;
+            entryCount += rangeEntries;
+        }
+    }
+
+    quadOffsets[quadCount] = entryCount;
+
+    std::vector<Index> indexes(entryCount);
+    threads.clear();
+    for (size_t range = 0; range < rangeCount; range++)
+    {
+        threads.push_back(std::thread(&GridIndex::PlaceQuadEntries, this, rangeStarts[range], rangeStarts[range + 1], &rangeQuadCounts[range * quadCount], indexes.data()));
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    std::cout << "  Indexed " << segmentCount << " segments with " << entryCount << " square entries." << std::endl;
+    quadtree.SetQuads(std::move(quadOffsets), std::move(indexes));
+    quadtree.ComputeOccupancy();
+}
+
+void GridIndex::AddLineStrips(const LineStripSet* lineStrips, size_t startStrip)
+{
+    if (startStrip == 0)
+    {
+        quadtree.InitializeQuadtree(this->size);
+    }
+
+    // The arena in use isn't known until the first points are added.
+    this->lineStrips = lineStrips;
+    ChooseSearchFunction();
+
+    // Only the added strips are visited, with their entries merged after the existing entries of each square.
+    const size_t quadCount = (size_t)size * (size_t)size;
+    std::vector<size_t> quadOffsets(quadCount + 1, 0);
+    CountQuadEntries(startStrip, lineStrips->strips.size(), quadOffsets.data());
+
+    size_t entryCount = 0;
+    for (size_t quad = 0; quad < quadCount; quad++)
+    {
+        size_t quadEntries = quadOffsets[quad];
+        quadOffsets[quad] = entryCount;
+        entryCount += quadEntries;
+    }
+
+    quadOffsets[quadCount] = entryCount;
+
+    std::vector<size_t> placementOffsets(quadOffsets);
+    std::vector<Index> indexes(entryCount);
+    PlaceQuadEntries(startStrip, lineStrips->strips.size(), placementOffsets.data(), indexes.data());
+
+    quadtree.AppendQuads(quadOffsets, indexes);
+    quadtree.ComputeOccupancy();
+}
+
+void GridIndex::AddIfValid(int xP, int yP, std::vector<GridPoint>& searchQuads) const
+{
+    GridPoint pt(xP, yP);
+    if (xP >= 0 && yP >= 0 && xP < size && yP < size && quadtree.ElementsInQuad(pt) != 0)
+    {
+        searchQuads.push_back(GridPoint(xP, yP));
+    }
+}
+
+void GridIndex::AddAreasToSearch(int distance, GridPoint startQuad, std::vector<GridPoint>& searchQuads) const
+{
+    if (distance == 1)
+    {
+        searchQuads.push_back(startQuad);
+    }
+
+    // Add the horizontal bars
+    for (int i = startQuad.x - distance; i <= startQuad.x + distance; i++)
+    {
+        AddIfValid(i, startQuad.y + distance, searchQuads);
+        AddIfValid(i, startQuad.y - distance, searchQuads);
+    }
+
+    // Add the vertical bars, skipping the corners that otherwise would be duplicated.
+    for (int j = startQuad.y - (distance - 1); j <= startQuad.y + (distance - 1); j++)
+    {
+        AddIfValid(startQuad.x + distance, j, searchQuads);
+        AddIfValid(startQuad.x - distance, j, searchQuads);
+    }
+}
+
+void GridIndex::Search(Point point, ElevationComputer& elevationComputer, RasterCost* cost) const
+{
+    (this->*searchLines)(point, elevationComputer, cost);
+}
+
+template <typename T>
+void GridIndex::SearchLines(Point point, ElevationComputer& elevationComputer, RasterCost* cost) const
+{
+    GridPoint quadSquare = GetQuadtreeSquare(point);
+
+    // Loop forever as we are guaranteed to eventually find a point.
+    int gridDistance = 1;
+    std::vector<GridPoint> searchQuads;
+    int maxIterations = MaxRings;
+
+    // Stop as soon as the remaining rings (up to the hard stop) hold no lines, as they can no longer change the result.
+    // Stopping on distance alone is not exact, as any line at all fills an empty sector.
+    int reachableQuads = quadtree.OccupiedQuadsWithin(quadSquare, MaxRings);
+
+    // Skip straight to the first ring that can hold lines. Skipped rings still count towards the hard stop.
+    int skippedRings = std::min(quadtree.DistanceToOccupiedQuad(quadSquare) - 1, maxIterations);
+    if (skippedRings > 0)
+    {
+        gridDistance += skippedRings;
+        maxIterations -= skippedRings;
+    }
+
+    while (maxIterations > 0)
+    {
+        int searchedQuads = quadtree.OccupiedQuadsWithin(quadSquare, gridDistance == 1 ? -1 : gridDistance - 1);
+        if (searchedQuads == reachableQuads)
+        {
+            return;
+        }
+
+        --maxIterations;
+        searchQuads.clear();
+        AddAreasToSearch(gridDistance, quadSquare, searchQuads);
+        if (cost != nullptr)
+        {
+            ++cost->ringsVisited;
+        }
+
+        // Iterate through each search region and each element in each region, processing the line with the computer
+        for (size_t k = 0; k < searchQuads.size(); k++)
+        {
+            size_t indexCount = quadtree.ElementsInQuad(searchQuads[k]);
+            if (cost != nullptr)
+            {
+                cost->segmentsTested += (int)indexCount;
+            }
+
+            for (size_t i = 0; i < indexCount; i++)
+            {
+                Index index = quadtree.GetIndexFromQuad(searchQuads[k], (int)i);
+                T start, end;
+                lineStrips->GetStoredSegment(index, &start, &end);
+                elevationComputer.ProcessLine(start, end, lineStrips->strips[index.stripIdx].elevation);
+            }
+
+            if (elevationComputer.HasSufficientData())
+            {
+                return;
+            }
+        }
+
+        // Increment the grids we search.
+        ++gridDistance;
+    }
+}
+
+void GridIndex::FindSegmentsNear(Point point, double distance, std::vector<Index>& segments) const
+{
+    // Segments are indexed in every square they cross, so the squares overlapping the distance hold all segments within it.
+    GridPoint minQuad = GetQuadtreeSquare(Point(point.x - distance, point.y - distance));
+    GridPoint maxQuad = GetQuadtreeSquare(Point(point.x + distance, point.y + distance));
+    for (int y = minQuad.y; y <= maxQuad.y; y++)
+    {
+        for (int x = minQuad.x; x <= maxQuad.x; x++)
+        {
+            GridPoint quad(x, y);
+            for (size_t k = 0; k < quadtree.ElementsInQuad(quad); k++)
+            {
+                segments.push_back(quadtree.GetIndexFromQuad(quad, (int)k));
+            }
+        }
+    }
+}
@@ -0,0 +1,201 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include "Quadtree.h"
+#include "SegmentIndex.h"
+
+// Indexes segments in a uniform [size]x[size] grid, searching rings of squares outwards from each point.
+class GridIndex : public SegmentIndex
+{
+    // The number of quadtree xy grid spaces.
+    int size;
+    Quadtree quadtree;
+    const LineStripSet* lineStrips;
+
+    // The most square counts Build holds at once, one set per thread, which limits how many threads count in parallel.
+    size_t maxCountEntries;
+
+    // Map the given (normalized) points to 0-(size - 1) (defaults to 0-9) for block-based lookup.
+    // Points outside 0-1 (in the margin of --Bounds) are clamped to the edge squares, so segments are clipped to the grid before being walked.
+    template <typename T>
+    GridPoint GetQuadtreeSquare(T givenPoint) const
+    {
+        Point point = ToPoint(givenPoint);
+        return GridPoint(
+            std::max(std::min((int)std::floor(point.x * (double)size), size - 1), 0),
+            std::max(std::min((int)std::floor(point.y * (double)size), size - 1), 0));
+    }
+
+    // Calls the visitor with each square along the line of squares from start to end, and those beside them.
+    template <typename Visitor>
+    void VisitSquareLine(GridPoint quadStart, GridPoint quadEnd, Index index, Visitor& visit) const
+    {
+        // Add the start
+        visit(quadStart, index);
+
+        // Add where the line intersects to the quadtree, iterating in the length where our V1 algorithm works.
+        GridPoint distance = quadEnd - quadStart;
+        if (quadEnd.x == quadStart.x && quadEnd.y == quadStart.y)
+        {
+            return;
+        }
+        else if (std::abs(distance.x) >= std::abs(distance.y))
+        {
+            // Iterate X, going in the negative or positive direction appropriately.
+            int x = quadStart.x;
+            const int increment = quadStart.x < quadEnd.x ? 1 : -1;
+            const float yDelta = (float)distance.y / (float)std::abs(distance.x);
+        
+            int currentX = 0;
+            while (x != quadEnd.x)
+            {
+                x += increment;
+                ++currentX;
+        
+                int y = (int)(yDelta * currentX + quadStart.y);
+        
+                // V1: Add to both Y plus and minus 1 to be pessimistic
+                visit(GridPoint(x, y), index);
+                visit(GridPoint(x, y + 1), index);
+                visit(GridPoint(x, y - 1), index);
+            }
+        }
+        else
+        {
+            // Iterate Y, going in the negative or positive direction appropriately.
+            int y = quadStart.y;
+            const int increment = quadStart.y < quadEnd.y ? 1 : -1;
+            const float xDelta = (float)distance.x / (float)std::abs(distance.y);
+        
+            int currentY = 0;
+            while (y != quadEnd.y)
+            {
+                y += increment;
+                ++currentY;
+        
+                int x = (int)(xDelta * currentY + quadStart.x);
+        
+                // V1: Add to both X plus and minus 1 to be pessimistic
+                visit(GridPoint(x, y), index);
+                visit(GridPoint(x + 1, y), index);
+                visit(GridPoint(x - 1, y), index);
+            }
+        }
+    }
+
+    // Calls the visitor with each square the segments of the strip are indexed in, and the segment index.
+    // A square may be visited more than once per segment, and squares outside of the grid may be visited.
+    template <typename T, typename Visitor>
+    void VisitSegmentQuads(int lineStripIndex, const T* points, uint32_t count, Visitor& visit) const
+    {
+        for (uint32_t j = 0; j + 1 < count; j++)
+        {
+            Point start = ToPoint(points[j]);
+            Point end = ToPoint(points[j + 1]);
+            Index index(lineStripIndex, j);
+
+            // Segments entirely in the margin of --Bounds are indexed in the edge squares nearest to them.
+            Point gridStart = start;
+            Point gridEnd = end;
+            if (!ClipSegment(0.0, 1.0, &gridStart, &gridEnd))
+            {
+                VisitSquareLine(GetQuadtreeSquare(start), GetQuadtreeSquare(end), index, visit);
+                continue;
+            }
+
+            // Otherwise the part within the grid is walked from where it enters, and any parts in the margin are indexed along the edge.
+            if (gridStart.x != start.x || gridStart.y != start.y)
+            {
+                VisitSquareLine(GetQuadtreeSquare(start), GetQuadtreeSquare(gridStart), index, visit);
+            }
+
+            VisitSquareLine(GetQuadtreeSquare(gridStart), GetQuadtreeSquare(gridEnd), index, visit);
+            if (gridEnd.x != end.x || gridEnd.y != end.y)
+            {
+                VisitSquareLine(GetQuadtreeSquare(gridEnd), GetQuadtreeSquare(end), index, visit);
+            }
+        }
+    }
+
+    // Visits the squares of all segments of the strips in [startStrip, endStrip), in order.
+    template <typename Visitor>
+    void VisitStripQuads(size_t startStrip, size_t endStrip, Visitor& visit) const
+    {
+        for (size_t i = startStrip; i < endStrip; i++)
+        {
+            const LineStrip& lineStrip = lineStrips->strips[i];
+            if (!lineStrips->quantizedPoints.empty())
+            {
+                VisitSegmentQuads((int)i, lineStrips->GetPoints<QuantizedPoint>(lineStrip), lineStrip.count, visit);
+            }
+            else if (!lineStrips->points.empty())
+            {
+                VisitSegmentQuads((int)i, lineStrips->GetPoints<Point>(lineStrip), lineStrip.count, visit);
+            }
+            else
+            {
+                VisitSegmentQuads((int)i, lineStrips->GetPoints<LowResPoint>(lineStrip), lineStrip.count, visit);
+            }
+        }
+    }
+
+    bool IsInGrid(GridPoint quad) const
+    {
+        return quad.x >= 0 && quad.y >= 0 && quad.x < size && quad.y < size;
+    }
+
+    // Counts the entries of each square from a range of strips, then places them once the offsets are known.
+    void CountQuadEntries(size_t startStrip, size_t endStrip, size_t* quadCounts) const;
+    void PlaceQuadEntries(size_t startStrip, size_t endStrip, size_t* quadOffsets, Index* indexes) const;
+
+    // Adds an area if it is valid.
+    void AddIfValid(int xP, int yP, std::vector<GridPoint>& searchQuads) const;
+
+    // Adds areas to search given the current point and distance away from it.
+    void AddAreasToSearch(int distance, GridPoint startQuad, std::vector<GridPoint>& searchQuads) const;
+
+    // Searches reading the segments as stored in the arena of type T, chosen by Build for the lines indexed.
+    template <typename T>
+    void SearchLines(Point point, ElevationComputer& elevationComputer, RasterCost* cost) const;
+
+    typedef void (GridIndex::*SearchFunction)(Point point, ElevationComputer& elevationComputer, RasterCost* cost) const;
+    SearchFunction searchLines;
+
+    // Chooses the specialization of SearchLines for the arena in use by the lines.
+    void ChooseSearchFunction();
+
+public:
+    // The search stops after this many rings, to handle edge cases where there won't be edge lines for the computer to find.
+    static const int MaxRings = 90;
+
+    // Returns how far from a point, as a fraction of the indexed area, the lines a search finds can be.
+    // That is MaxRings squares, plus the square beside each crossed square that segments are also indexed in. The R-tree stops at MaxRings squares.
+    static double GetSearchReach(int size)
+    {
+        return (double)(MaxRings + 2) / (double)size;
+    }
+
+    // The default limit of the square counts Build holds at once, 128 MiB.
+    static const size_t DefaultMaxCountEntries = 16 * 1024 * 1024;
+
+    GridIndex(int size, size_t maxCountEntries = DefaultMaxCountEntries);
+
+    // Returns the bytes an index of [size]x[size] squares holds besides its entries, which take sizeof(Index) each.
+    static double GetSquareBytes(int size);
+
+    // Returns the most bytes Build uses while counting the entries, on top of the finished index.
+    static double GetBuildBytes(int size, size_t maxCountEntries);
+
+    virtual void Build(const LineStripSet* lineStrips) override;
+
+    // Indexes the strips from [startStrip] on after those already indexed, for a set that grows as it loads, starting over at 0.
+    // The squares list their entries in the same order as Build. The set must not change while the index is searched.
+    void AddLineStrips(const LineStripSet* lineStrips, size_t startStrip);
+    virtual void Search(Point point, ElevationComputer& elevationComputer, RasterCost* cost) const override;
+
+    // Returns the segments in the squares within the distance of the point. Segments crossing several of them are returned more than once.
+    virtual void FindSegmentsNear(Point point, double distance, std::vector<Index>& segments) const override;
+};
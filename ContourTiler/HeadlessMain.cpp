@@ -0,0 +1,69 @@
+#include <iostream>
+#include <thread>
+#include "BulkExporter.h"
+#include "LineStripLoader.h"
+#include "OutOfCoreExporter.h"
+#include "Rasterizer.h"
+#include "Settings.h"
+#include "TileManifest.h"
+#include "TileServer.h"
+
+// Performs the interpolation and tiling of contours without a graphical display.
+int main(int argc, const char* argv[])
+{
+    std::cout << "ContourTiler (headless)" << std::endl;
+    std::cout << "  Detected " << std::thread::hardware_concurrency() << " hardware cores." << std::endl;
+    Settings settings;
+    if (!settings.ParseArguments(argc, argv))
+    {
+        std::cout << "Unable to parse the input arguments!" << std::endl;
+        settings.OutputUsage();
+        return 1;
+    }
+
+    if (settings.IsMerging)
+    {
+        return TileManifest::Merge(&settings) ? 0 : 1;
+    }
+
+    if (settings.IsOutOfCore)
+    {
+        OutOfCoreExporter outOfCoreExporter;
+        if (!outOfCoreExporter.Export(&settings))
+        {
+            std::cout << "Out-of-core export failed!" << std::endl;
+            return 1;
+        }
+
+        std::cout << "Done." << std::endl;
+        return 0;
+    }
+
+    LineStripLoader lineStripLoader;
+    if (!lineStripLoader.Initialize(&settings))
+    {
+        std::cout << "Could not parse the input files!" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::endl;
+    std::cout << "==Initializing Environment==" << std::endl;
+    Rasterizer rasterizer(&lineStripLoader);
+    rasterizer.Setup(&settings);
+
+    if (settings.IsServing)
+    {
+        TileServer tileServer(&rasterizer);
+        return tileServer.Run(&settings) ? 0 : 1;
+    }
+
+    BulkExporter bulkExporter(&rasterizer);
+    if (!bulkExporter.Export(&settings))
+    {
+        std::cout << "Bulk export failed!" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Done." << std::endl;
+    return 0;
+}
@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <cstring>
+#ifdef _WIN32
+    #include <intrin.h>
+#endif
+#include "HeightCodec.h"
+
+static void WriteUInt32(unsigned char* data, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        data[i] = (unsigned char)(value >> (i * 8));
+    }
+}
+
+static uint32_t ReadUInt32(const unsigned char* data)
+{
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+// Compilers turn this into a single load on little-endian machines.
+static uint64_t ReadUInt64(const unsigned char* data)
+{
+    return (uint64_t)ReadUInt32(data) | ((uint64_t)ReadUInt32(data + 4) << 32);
+}
+
+static int CountTrailingZeros(uint64_t value)
+{
+#ifdef _WIN32
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return (int)index;
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+// Median edge detector from the left (a), upper (b) and upper-left (c) heights.
+static uint16_t PredictHeight(uint16_t a, uint16_t b, uint16_t c)
+{
+    uint16_t minimum = std::min(a, b);
+    uint16_t maximum = std::max(a, b);
+    if (c >= maximum)
+    {
+        return minimum;
+    }
+
+    if (c <= minimum)
+    {
+        return maximum;
+    }
+
+    return (uint16_t)(a + b - c);
+}
+
+// Predicts every height of a row, with the first row predicted from the left and the first column from above.
+// Rows are decoded in place, so the heights up to x (exclusive) and the row above must be final.
+static uint16_t PredictAt(const uint16_t* row, const uint16_t* rowAbove, int x)
+{
+    if (rowAbove == nullptr)
+    {
+        return x == 0 ? 0 : row[x - 1];
+    }
+
+    return x == 0 ? rowAbove[0] : PredictHeight(row[x - 1], rowAbove[x], rowAbove[x - 1]);
+}
+
+// Appends bits LSB first.
+struct BitWriter
+{
+    std::vector<unsigned char>& encoded;
+    uint64_t bits;
+    int bitCount;
+
+    BitWriter(std::vector<unsigned char>& encoded)
+        : encoded(encoded), bits(0), bitCount(0)
+    { }
+
+    // Writes up to 32 bits.
+    void Write(uint32_t value, int count)
+    {
+        bits |= (uint64_t)value << bitCount;
+        bitCount += count;
+        if (bitCount >= 32)
+        {
+            unsigned char word[4];
+            WriteUInt32(word, (uint32_t)bits);
+            encoded.insert(encoded.end(), word, word + 4);
+            bits >>= 32;
+            bitCount -= 32;
+        }
+    }
+
+    void Flush()
+    {
+        while (bitCount > 0)
+        {
+            encoded.push_back((unsigned char)bits);
+            bits >>= 8;
+            bitCount -= 8;
+        }
+
+        bits = 0;
+        bitCount = 0;
+    }
+};
+
+const char* HeightCodec::Magic()
+{
+    return "CTH1";
+}
+
+bool HeightCodec::IsEncoded(const unsigned char* data, size_t size)
+{
+    return size >= HeaderSize && std::memcmp(data, Magic(), MagicSize) == 0;
+}
+
+void HeightCodec::Encode(const uint16_t* heights, int width, int height, std::vector<unsigned char>& encoded)
+{
+    size_t count = (size_t)width * (size_t)height;
+    encoded.clear();
+    encoded.reserve(HeaderSize + count + Padding);
+    encoded.resize(HeaderSize);
+    std::memcpy(&encoded[0], Magic(), MagicSize);
+    WriteUInt32(&encoded[4], (uint32_t)width);
+    WriteUInt32(&encoded[8], (uint32_t)height);
+
+    // Zigzagged residuals, so small positive and negative residuals both become small values.
+    std::vector<uint16_t> residuals(count);
+    for (int y = 0; y < height; y++)
+    {
+        const uint16_t* row = heights + (size_t)y * width;
+        const uint16_t* rowAbove = y == 0 ? nullptr : row - width;
+        uint16_t* residualRow = &residuals[(size_t)y * width];
+        for (int x = 0; x < width; x++)
+        {
+            int16_t residual = (int16_t)(uint16_t)(row[x] - PredictAt(row, rowAbove, x));
+            residualRow[x] = (uint16_t)((residual << 1) ^ (residual >> 15));
+        }
+    }
+
+    BitWriter writer(encoded);
+    for (size_t blockStart = 0; blockStart < count; blockStart += BlockSize)
+    {
+        size_t blockEnd = std::min(blockStart + BlockSize, count);
+        uint64_t sum = 0;
+        for (size_t i = blockStart; i < blockEnd; i++)
+        {
+            sum += residuals[i];
+        }
+
+        if (sum == 0)
+        {
+            writer.Write(ZeroBlock, ParameterBits);
+            continue;
+        }
+
+        // The parameter closest to log2 of the mean residual.
+        uint32_t parameter = 0;
+        while (parameter < 16 && ((uint64_t)(blockEnd - blockStart) << (parameter + 1)) <= sum)
+        {
+            ++parameter;
+        }
+
+        writer.Write(parameter, ParameterBits);
+        for (size_t i = blockStart; i < blockEnd; i++)
+        {
+            // The quotient in unary as zeros ended by a one, then the remainder.
+            uint32_t quotient = (uint32_t)residuals[i] >> parameter;
+            if (quotient < EscapeQuotient)
+            {
+                writer.Write(1u << quotient, quotient + 1);
+                writer.Write(residuals[i] & ((1u << parameter) - 1), parameter);
+            }
+            else
+            {
+                writer.Write(1u << EscapeQuotient, EscapeQuotient + 1);
+                writer.Write(residuals[i], 16);
+            }
+        }
+    }
+
+    writer.Flush();
+    encoded.resize(encoded.size() + Padding, 0);
+}
+
+bool HeightCodec::Decode(const unsigned char* data, size_t size, std::vector<uint16_t>& heights, int* width, int* height)
+{
+    if (!IsEncoded(data, size) || size < HeaderSize + Padding)
+    {
+        return false;
+    }
+
+    uint32_t encodedWidth = ReadUInt32(data + 4);
+    uint32_t encodedHeight = ReadUInt32(data + 8);
+    if (encodedWidth == 0 || encodedHeight == 0 || encodedWidth > 65536 || encodedHeight > 65536)
+    {
+        return false;
+    }
+
+    // Every block takes at least its parameter.
+    size_t count = (size_t)encodedWidth * (size_t)encodedHeight;
+    const unsigned char* stream = data + HeaderSize;
+    size_t streamSize = size - HeaderSize;
+    if ((count + BlockSize - 1) / BlockSize * ParameterBits > streamSize * 8)
+    {
+        return false;
+    }
+
+    // Decode the residuals, reading 8 bytes (at least 57 new bits) for each value.
+    heights.resize(count);
+    uint64_t bitPosition = 0;
+    for (size_t blockStart = 0; blockStart < count; blockStart += BlockSize)
+    {
+        size_t blockEnd = std::min(blockStart + (size_t)BlockSize, count);
+        if ((bitPosition >> 3) + 8 > streamSize)
+        {
+            return false;
+        }
+
+        uint32_t parameter = (uint32_t)(ReadUInt64(stream + (bitPosition >> 3)) >> (bitPosition & 7)) & ((1u << ParameterBits) - 1);
+        bitPosition += ParameterBits;
+        if (parameter == ZeroBlock)
+        {
+            std::fill(heights.begin() + blockStart, heights.begin() + blockEnd, (uint16_t)0);
+            continue;
+        }
+
+        if (parameter > 16)
+        {
+            return false;
+        }
+
+        // Only blocks near the end of the stream need checking as they're read.
+        uint32_t remainderMask = (1u << parameter) - 1;
+        bool isBlockInStream = (bitPosition >> 3) + (BlockSize * (EscapeQuotient + 17) + 7) / 8 + 8 <= streamSize;
+        for (size_t i = blockStart; i < blockEnd; i++)
+        {
+            if (!isBlockInStream && (bitPosition >> 3) + 8 > streamSize)
+            {
+                return false;
+            }
+
+            uint64_t bits = ReadUInt64(stream + (bitPosition >> 3)) >> (bitPosition & 7);
+            if ((bits & ((1ull << (EscapeQuotient + 1)) - 1)) == 0)
+            {
+                return false;
+            }
+
+            uint32_t quotient = (uint32_t)CountTrailingZeros(bits);
+            if (quotient == EscapeQuotient)
+            {
+                heights[i] = (uint16_t)(bits >> (EscapeQuotient + 1));
+                bitPosition += EscapeQuotient + 1 + 16;
+            }
+            else
+            {
+                heights[i] = (uint16_t)((quotient << parameter) | ((uint32_t)(bits >> (quotient + 1)) & remainderMask));
+                bitPosition += quotient + 1 + parameter;
+            }
+        }
+    }
+
+    // Undo the prediction in place, row by row.
+    for (uint32_t y = 0; y < encodedHeight; y++)
+    {
+        uint16_t* row = &heights[(size_t)y * encodedWidth];
+        const uint16_t* rowAbove = y == 0 ? nullptr : row - encodedWidth;
+        for (uint32_t x = 0; x < encodedWidth; x++)
+        {
+            uint16_t residual = row[x];
+            row[x] = (uint16_t)(PredictAt(row, rowAbove, (int)x) + ((residual >> 1) ^ (uint16_t)(0 - (residual & 1))));
+        }
+    }
+
+    *width = (int)encodedWidth;
+    *height = (int)encodedHeight;
+    return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Lossless codec for 16-bit heightmaps, built for smooth terrain.
+//   Each height is predicted from its left, upper and upper-left neighbours with the median edge detector (MED) of LOCO-I,
+//   which follows slopes and snaps to ridges and cliffs, leaving residuals near 0.
+//   The zigzagged residuals are Rice coded in blocks of BlockSize, each block with its own Rice parameter.
+//   Blocks of only zero residuals (flat areas) are a single parameter, and residuals too large for their block are escaped.
+// Layout: magic, width (u32), height (u32), then the bitstream (LSB first), padded with zero bytes so decoding can read ahead.
+class HeightCodec
+{
+    // Marks a block whose residuals are all 0.
+    static const uint32_t ZeroBlock = 17;
+    static const uint32_t ParameterBits = 5;
+
+    // Residuals with this quotient or larger are written raw after the escape.
+    static const uint32_t EscapeQuotient = 24;
+
+public:
+    static const int BlockSize = 32;
+    static const size_t MagicSize = 4;
+    static const size_t HeaderSize = 12;
+    static const size_t Padding = 8;
+
+    static const char* Magic();
+
+    // Returns true if the data starts like an encoded heightmap.
+    static bool IsEncoded(const unsigned char* data, size_t size);
+
+    static void Encode(const uint16_t* heights, int width, int height, std::vector<unsigned char>& encoded);
+
+    // Decodes into [Width]x[Height] heights, returning false (without printing) if the data is invalid or truncated.
+    static bool Decode(const unsigned char* data, size_t size, std::vector<uint16_t>& heights, int* width, int* height);
+};
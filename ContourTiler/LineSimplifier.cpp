@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <thread>
+#include "LineSimplifier.h"
+
+LineSimplifier::LineSimplifier(double tolerance, double scaleX, double scaleY)
+    : scaleX(scaleX), scaleY(scaleY), toleranceSqd(tolerance * tolerance)
+{ }
+
+void LineSimplifier::Simplify(LineStripSet& lineStrips, LineStrip& lineStrip) const
+{
+    // Only one of these is populated, depending on the resolution setting.
+    if (!lineStrips.points.empty())
+    {
+        Simplify(lineStrips.GetPoints<Point>(lineStrip), lineStrip.count);
+    }
+    else if (!lineStrips.lowResPoints.empty())
+    {
+        Simplify(lineStrips.GetPoints<LowResPoint>(lineStrip), lineStrip.count);
+    }
+    else if (!lineStrips.quantizedPoints.empty())
+    {
+        Simplify(lineStrips.GetPoints<QuantizedPoint>(lineStrip), lineStrip.count);
+    }
+}
+
+void LineSimplifier::SimplifyRange(LineStripSet* lineStrips, size_t start, size_t end) const
+{
+    for (size_t i = start; i < end; i++)
+    {
+        Simplify(*lineStrips, lineStrips->strips[i]);
+    }
+}
+
+void LineSimplifier::SimplifyAll(LineStripSet& lineStrips) const
+{
+    unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    size_t stripsPerThread = (lineStrips.strips.size() + threadCount - 1) / threadCount;
+
+    // Each strip only moves points within its own range of the arena.
+    std::vector<std::thread> threads;
+    for (size_t start = 0; start < lineStrips.strips.size(); start += stripsPerThread)
+    {
+        size_t end = std::min(start + stripsPerThread, lineStrips.strips.size());
+        threads.push_back(std::thread(&LineSimplifier::SimplifyRange, this, &lineStrips, start, end));
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    lineStrips.Compact();
+}
+
+size_t LineSimplifier::CountSegments(const LineStripSet& lineStrips)
+{
+    size_t segments = 0;
+    for (const LineStrip& lineStrip : lineStrips.strips)
+    {
+        segments += lineStrip.count > 1 ? lineStrip.count - 1 : 0;
+    }
+
+    return segments;
+}
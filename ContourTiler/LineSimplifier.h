@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "LineStripSet.h"
+
+// Removes line strip vertices that are closer together than the output can resolve, using Douglas-Peucker simplification.
+class LineSimplifier
+{
+    // Converts normalized coordinate deltas into tolerance units on each axis.
+    double scaleX;
+    double scaleY;
+    double toleranceSqd;
+
+    // Squared distance, in tolerance units, from the point to the line from start to end.
+    template <typename T>
+    double GetScaledDistanceSqd(const T& point, const T& start, const T& end) const
+    {
+        Point pointValue = ToPoint(point);
+        Point startValue = ToPoint(start);
+        Point endValue = ToPoint(end);
+        double startToEndX = (endValue.x - startValue.x) * scaleX;
+        double startToEndY = (endValue.y - startValue.y) * scaleY;
+        double startToPointX = (pointValue.x - startValue.x) * scaleX;
+        double startToPointY = (pointValue.y - startValue.y) * scaleY;
+
+        double lengthSqd = startToEndX * startToEndX + startToEndY * startToEndY;
+        double projectionFraction = lengthSqd == 0.0 ? 0.0 : (startToPointX * startToEndX + startToPointY * startToEndY) / lengthSqd;
+        projectionFraction = projectionFraction < 0.0 ? 0.0 : (projectionFraction > 1.0 ? 1.0 : projectionFraction);
+
+        double offsetX = startToPointX - startToEndX * projectionFraction;
+        double offsetY = startToPointY - startToEndY * projectionFraction;
+        return offsetX * offsetX + offsetY * offsetY;
+    }
+
+    template <typename T>
+    void Simplify(T* points, uint32_t& count) const
+    {
+        if (count < 3)
+        {
+            return;
+        }
+
+        // Iterative Douglas-Peucker, marking the vertices to keep.
+        std::vector<bool> keep(count, false);
+        keep[0] = true;
+        keep[count - 1] = true;
+
+        std::vector<std::pair<size_t, size_t>> ranges;
+        ranges.push_back(std::make_pair((size_t)0, (size_t)count - 1));
+        while (!ranges.empty())
+        {
+            std::pair<size_t, size_t> range = ranges.back();
+            ranges.pop_back();
+
+            double furthestDistanceSqd = 0.0;
+            size_t furthestPoint = range.first;
+            for (size_t i = range.first + 1; i < range.second; i++)
+            {
+                double distanceSqd = GetScaledDistanceSqd(points[i], points[range.first], points[range.second]);
+                if (distanceSqd > furthestDistanceSqd)
+                {
+                    furthestDistanceSqd = distanceSqd;
+                    furthestPoint = i;
+                }
+            }
+
+            if (furthestDistanceSqd > toleranceSqd)
+            {
+                keep[furthestPoint] = true;
+                ranges.push_back(std::make_pair(range.first, furthestPoint));
+                ranges.push_back(std::make_pair(furthestPoint, range.second));
+            }
+        }
+
+        uint32_t keptPoints = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (keep[i])
+            {
+                points[keptPoints++] = points[i];
+            }
+        }
+
+        count = keptPoints;
+    }
+
+    void SimplifyRange(LineStripSet* lineStrips, size_t start, size_t end) const;
+
+public:
+    // Vertices within the tolerance of the simplified line are removed. The scales convert normalized coordinates into tolerance units.
+    LineSimplifier(double tolerance, double scaleX, double scaleY);
+
+    // Simplifies a single line strip in place, reducing its point count.
+    void Simplify(LineStripSet& lineStrips, LineStrip& lineStrip) const;
+
+    // Simplifies all the line strips, split across all cores, then compacts the arena.
+    void SimplifyAll(LineStripSet& lineStrips) const;
+
+    // Returns the number of line segments in all the line strips.
+    static size_t CountSegments(const LineStripSet& lineStrips);
+};
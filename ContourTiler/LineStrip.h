@@ -1,11 +1,17 @@
 #pragma once
-#include <vector>
-#include "Point.h"
+#include <cstddef>
+#include <cstdint>
 
-// Line data format.
+// Line data format. The points are [count] consecutive points from [offset] in the arena of a LineStripSet.
 struct LineStrip
 {
     double elevation;
-    std::vector<Point> points;
-    std::vector<LowResPoint> lowResPoints;
-};
\ No newline at end of file
+    size_t offset;
+    uint32_t count;
+
+    LineStrip() : elevation(0.0), offset(0), count(0)
+    { }
+
+    LineStrip(double elevation, size_t offset, uint32_t count) : elevation(elevation), offset(offset), count(count)
+    { }
+};
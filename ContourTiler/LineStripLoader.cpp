@@ -1,200 +1,558 @@
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <iostream>
-#include <fstream>
+#include <functional>
 #include <limits>
 #include <thread>
 #include <map>
 #include <set>
-#include <nlohmann/json.hpp>
+#include <sstream>
+#include "GeoJsonReader.h"
+#include "GridIndex.h"
+#include "LineSimplifier.h"
 #include "LineStripLoader.h"
+#include "ShapefileReader.h"
 
-using json = nlohmann::json;
+const size_t LineStripLoader::MaxScannedPoints;
 
 LineStripLoader::LineStripLoader()
+    : minX(0.0), maxX(1.0), minY(0.0), maxY(1.0), minElevation(0.0), maxElevation(1.0), pointCount(0), lineStripCount(0), progressStage("Starting"), progressFraction(0.0)
 {
 }
 
-bool LineStripLoader::Initialize(Settings* settings)
+void LineStripLoader::SetProgress(const std::string& stage, double fraction)
 {
-    std::map<int, int> elevationMap;
-    lineStrips.clear();
+    std::lock_guard<std::mutex> lock(progressMutex);
+    progressStage = stage;
+    progressFraction = fraction;
+}
+
+void LineStripLoader::GetProgress(std::string* stage, double* fraction) const
+{
+    std::lock_guard<std::mutex> lock(progressMutex);
+    *stage = progressStage;
+    *fraction = progressFraction;
+}
+
+// Returns true if any part of the line set is within the bounds, including the margin.
+static bool IsWithinBounds(const ContourLineSet& lineSet, Settings* settings)
+{
+    double marginX = (settings->BoundsMaxX - settings->BoundsMinX) * settings->BoundsMargin;
+    double marginY = (settings->BoundsMaxY - settings->BoundsMinY) * settings->BoundsMargin;
+
+    double lineSetMinX = std::numeric_limits<double>::max();
+    double lineSetMaxX = std::numeric_limits<double>::lowest();
+    double lineSetMinY = std::numeric_limits<double>::max();
+    double lineSetMaxY = std::numeric_limits<double>::lowest();
+    for (size_t i = 0; i < lineSet.count; i++)
+    {
+        const Point& point = lineSet.points[i];
+        lineSetMinX = std::min(point.x, lineSetMinX);
+        lineSetMinY = std::min(point.y, lineSetMinY);
+        lineSetMaxX = std::max(point.x, lineSetMaxX);
+        lineSetMaxY = std::max(point.y, lineSetMaxY);
+    }
+
+    return lineSetMaxX >= settings->BoundsMinX - marginX && lineSetMinX <= settings->BoundsMaxX + marginX &&
+        lineSetMaxY >= settings->BoundsMinY - marginY && lineSetMinY <= settings->BoundsMaxY + marginY;
+}
+
+// Adds every [stride]th point of the line set (and its last point) as a strip in source units, for previewing the boundary scan.
+static void AddScannedLineSet(const ContourLineSet& lineSet, double elevation, size_t stride, LineStripSet& scannedStrips)
+{
+    if (lineSet.count == 0)
+    {
+        return;
+    }
+
+    LineStrip lineStrip(elevation, scannedStrips.points.size(), 0);
+    for (size_t j = 0; j < lineSet.count; j += stride)
+    {
+        scannedStrips.points.push_back(lineSet.points[j]);
+    }
+
+    if ((lineSet.count - 1) % stride != 0)
+    {
+        scannedStrips.points.push_back(lineSet.points[lineSet.count - 1]);
+    }
+
+    lineStrip.count = (uint32_t)(scannedStrips.points.size() - lineStrip.offset);
+    scannedStrips.strips.push_back(lineStrip);
+}
+
+// Drops every other point of each scanned strip, keeping its ends.
+static void ThinScannedStrips(LineStripSet& scannedStrips)
+{
+    std::vector<Point> thinnedPoints;
+    thinnedPoints.reserve(scannedStrips.points.size() / 2 + scannedStrips.strips.size());
+    for (LineStrip& lineStrip : scannedStrips.strips)
+    {
+        const Point* points = scannedStrips.GetPoints<Point>(lineStrip);
+        size_t offset = thinnedPoints.size();
+        for (uint32_t j = 0; j < lineStrip.count; j += 2)
+        {
+            thinnedPoints.push_back(points[j]);
+        }
+
+        if ((lineStrip.count - 1) % 2 != 0)
+        {
+            thinnedPoints.push_back(points[lineStrip.count - 1]);
+        }
+
+        lineStrip.offset = offset;
+        lineStrip.count = (uint32_t)(thinnedPoints.size() - offset);
+    }
+
+    scannedStrips.points.swap(thinnedPoints);
+}
+
+// Reads the contour features of a GeoJSON file or shapefile.
+static bool ReadFeatures(Settings* settings, const std::string& file, std::function<bool(const ContourFeature&)> onFeature)
+{
+    if (ShapefileReader::IsShapefile(file))
+    {
+        return ShapefileReader(settings->ElevationFeature).Read(file, onFeature);
+    }
+
+    return GeoJsonReader(settings->ElevationFeature).Read(file, onFeature);
+}
+
+// Returns true if the normalized line strip is within [Halo] tiles of the tile range.
+static bool IsWithinTileRange(const LineStripSet& lineStrips, const LineStrip& lineStrip, Settings* settings, int halo)
+{
+    double tileSize = 1.0 / (double)settings->RegionCount;
+    double stripMinX, stripMinY, stripMaxX, stripMaxY;
+    lineStrips.GetBounds(lineStrip, &stripMinX, &stripMinY, &stripMaxX, &stripMaxY);
+    return stripMaxX >= (double)(settings->TileRangeMinX - halo) * tileSize &&
+        stripMinX <= (double)(settings->TileRangeMaxX + 1 + halo) * tileSize &&
+        stripMaxY >= (double)(settings->TileRangeMinY - halo) * tileSize &&
+        stripMinY <= (double)(settings->TileRangeMaxY + 1 + halo) * tileSize;
+}
 
-    double minX = std::numeric_limits<double>::max();
-    double maxX = std::numeric_limits<double>::lowest();
-    double minY = std::numeric_limits<double>::max();
-    double maxY = std::numeric_limits<double>::lowest();
-    double minElevation = std::numeric_limits<double>::max();
-    double maxElevation = std::numeric_limits<double>::lowest();
+int LineStripLoader::GetTileRangeHalo(const Settings* settings)
+{
+    // The index covers the whole area, so a search reaches the same tiles as it would in a single process.
+    int searchHalo = (int)std::ceil(GridIndex::GetSearchReach(settings->RegionSize) * (double)settings->RegionCount);
+    return std::max(settings->BucketHalo, searchHalo);
+}
+
+bool LineStripLoader::NormalizeScannedStrips(const LineStripSet& scannedStrips, Settings* settings, LineStripSet& normalizedStrips) const
+{
+    double scanMinX = settings->HasBounds ? settings->BoundsMinX : minX;
+    double scanMaxX = settings->HasBounds ? settings->BoundsMaxX : maxX;
+    double scanMinY = settings->HasBounds ? settings->BoundsMinY : minY;
+    double scanMaxY = settings->HasBounds ? settings->BoundsMaxY : maxY;
+    if (!(scanMaxX > scanMinX) || !(scanMaxY > scanMinY))
+    {
+        return false;
+    }
+
+    double elevationRange = maxElevation - minElevation;
+    normalizedStrips.Clear();
+    normalizedStrips.strips = scannedStrips.strips;
+    normalizedStrips.points.reserve(scannedStrips.points.size());
+    for (LineStrip& lineStrip : normalizedStrips.strips)
+    {
+        lineStrip.elevation = elevationRange > 0 ? (lineStrip.elevation - minElevation) / elevationRange : 0.0;
+    }
+
+    for (const Point& point : scannedStrips.points)
+    {
+        normalizedStrips.points.push_back(Point((point.x - scanMinX) / (scanMaxX - scanMinX), 1.0 - ((point.y - scanMinY) / (scanMaxY - scanMinY))));
+    }
+
+    return true;
+}
+
+bool LineStripLoader::FindBoundaries(Settings* settings, std::function<void(const LineStripSet&)> onFileScanned)
+{
+    minX = std::numeric_limits<double>::max();
+    maxX = std::numeric_limits<double>::lowest();
+    minY = std::numeric_limits<double>::max();
+    maxY = std::numeric_limits<double>::lowest();
+    minElevation = std::numeric_limits<double>::max();
+    maxElevation = std::numeric_limits<double>::lowest();
 
     long featureCount = 0;
-    long lineSetCount = 0;
-    long pointCount = 0;
+    lineStripCount = 0;
+    pointCount = 0;
+    bool isPointCountEstimated = false;
+
+    // Shapefiles are only scanned for their headers, so only the other formats are previewed.
+    LineStripSet scannedStrips;
+    size_t scanStride = 1;
 
     std::cout << "=== Validating Data ===" << std::endl;
-    for (std::string geojsonFile : settings->GeoJsonFiles)
+    int fileIndex = 0;
+    for (std::string inputFile : settings->InputFiles)
+    {
+        std::stringstream stage;
+        stage << "Reading file " << (fileIndex + 1) << " of " << settings->InputFiles.size();
+        SetProgress(stage.str(), (double)fileIndex / (double)settings->InputFiles.size());
+        ++fileIndex;
+
+        double localMinX = std::numeric_limits<double>::max();
+        double localMaxX = std::numeric_limits<double>::lowest();
+        double localMinY = std::numeric_limits<double>::max();
+        double localMaxY = std::numeric_limits<double>::lowest();
+        double localMinElevation = std::numeric_limits<double>::max();
+        double localMaxElevation = std::numeric_limits<double>::lowest();
+
+        if (ShapefileReader::IsShapefile(inputFile) && !settings->HasBounds)
         {
-            std::ifstream lsf(geojsonFile, std::ios::in | std::ios::binary);
-            if (!lsf)
+            // Shapefile headers already hold the bounds, so only the elevation table is read.
+            std::cout << "Reading the boundaries of the shapefile '" << inputFile << "' ..." << std::endl;
+            ShapefileExtents extents;
+            if (!ShapefileReader(settings->ElevationFeature).ReadExtents(inputFile, &extents))
             {
-                std::cout << "Could not open the file to read contours from: " << geojsonFile << std::endl;
                 return false;
             }
 
-            std::cout << "Loading GeoJSON file '" << geojsonFile << "' ..." << std::endl;
-            json geoJson;
-            lsf >> geoJson;
-            std::cout << "Loaded GeoJSON file." << std::endl;
-
-            std::cout << "Finding boundaries of the GeoJSON file..." << std::endl;
-            double localMinX = std::numeric_limits<double>::max();
-            double localMaxX = std::numeric_limits<double>::lowest();
-            double localMinY = std::numeric_limits<double>::max();
-            double localMaxY = std::numeric_limits<double>::lowest();
-            double localMinElevation = std::numeric_limits<double>::max();
-            double localMaxElevation = std::numeric_limits<double>::lowest();
-
-            for (auto& feature : geoJson["features"])
+            localMinX = extents.minX;
+            localMinY = extents.minY;
+            localMaxX = extents.maxX;
+            localMaxY = extents.maxY;
+            localMinElevation = extents.minElevation;
+            localMaxElevation = extents.maxElevation;
+            featureCount += extents.shapeCount;
+            lineStripCount += extents.shapeCount;
+            pointCount += extents.maxPointCount;
+            isPointCountEstimated = true;
+        }
+        else
+        {
+            std::cout << "Finding boundaries of the file '" << inputFile << "' ..." << std::endl;
+            bool isRead = ReadFeatures(settings, inputFile, [&](const ContourFeature& feature)
             {
-                if (feature["properties"].find(settings->ElevationFeature.c_str()) == feature["properties"].end())
+                // Check to see if the countours re-define the boundaries.
+                bool anyLineSetInBounds = false;
+                for (size_t i = 0; i < feature.lineSetCount; i++)
                 {
-                    std::cout << "Could not find the property '" << settings->ElevationFeature << "' in the list of known properties for a feature!" << std::endl;
-                    return false;
-                }
+                    const ContourLineSet& lineSet = feature.lineSets[i];
+                    if (settings->HasBounds && !IsWithinBounds(lineSet, settings))
+                    {
+                        continue;
+                    }
 
-                double elevation = 0.0;
-                if (feature["properties"][settings->ElevationFeature.c_str()].is_number_integer())
-                {
-                    elevation = int(feature["properties"][settings->ElevationFeature.c_str()].get<int>());
-                }
-                else if (feature["properties"][settings->ElevationFeature.c_str()].is_number_float())
-                {
-                    elevation = feature["properties"][settings->ElevationFeature.c_str()].get<double>();
-                }
-                else
-                {
-                    std::cout << "The given elevation property was not an integer or a floating point value, but a '" <<
-                        feature["properties"][settings->ElevationFeature.c_str()].type_name() << "'. Only these two value types are supported." << std::endl;
-                    return false;
-                }
+                    anyLineSetInBounds = true;
+                    for (size_t j = 0; j < lineSet.count; j++)
+                    {
+                        const Point& point = lineSet.points[j];
+                        localMinX = std::min(point.x, localMinX);
+                        localMinY = std::min(point.y, localMinY);
+                        localMaxX = std::max(point.x, localMaxX);
+                        localMaxY = std::max(point.y, localMaxY);
+                    }
 
-                // Check to see if elevation redefines the boundaries.
-                localMinElevation = std::min(elevation, localMinElevation);
-                localMaxElevation = std::max(elevation, localMaxElevation);
+                    pointCount += (long)lineSet.count;
+                    ++lineStripCount;
 
-                // Check to see if the countours re-define the boundaries.
-                for (auto& lineSet : feature["geometry"]["coordinates"])
-                {
-                    for (auto& point : lineSet)
+                    if (onFileScanned)
                     {
-                        double x = point[0];
-                        double y = point[1];
-                        localMinX = std::min(x, localMinX);
-                        localMinY = std::min(y, localMinY);
-                        localMaxX = std::max(x, localMaxX);
-                        localMaxY = std::max(y, localMaxY);
-
-                        ++pointCount;
+                        AddScannedLineSet(lineSet, feature.elevation, scanStride, scannedStrips);
+                        if (scannedStrips.points.size() > MaxScannedPoints)
+                        {
+                            ThinScannedStrips(scannedStrips);
+                            scanStride *= 2;
+                        }
                     }
+                }
 
-                    ++lineSetCount;
+                if (anyLineSetInBounds)
+                {
+                    // Check to see if elevation redefines the boundaries.
+                    localMinElevation = std::min(feature.elevation, localMinElevation);
+                    localMaxElevation = std::max(feature.elevation, localMaxElevation);
+                    ++featureCount;
                 }
 
-                ++featureCount;
+                return true;
+            });
+
+            if (!isRead)
+            {
+                return false;
             }
+        }
 
-            std::cout << "Boundaries found of the file!" << std::endl;
-            std::cout << "  X: [" << localMinX << ", " << localMaxX << "], Y: [" << localMinY << ", " << localMaxY << "], Elevation: [" << localMinElevation << "," << localMaxElevation << "]" << std::endl;
+        std::cout << "Boundaries found of the file!" << std::endl;
+        std::cout << "  X: [" << localMinX << ", " << localMaxX << "], Y: [" << localMinY << ", " << localMaxY << "], Elevation: [" << localMinElevation << "," << localMaxElevation << "]" << std::endl;
 
-            minX = std::min(localMinX, minX);
-            minY = std::min(localMinY, minY);
-            minElevation = std::min(localMinElevation, minElevation);
-            maxX = std::max(localMaxX, maxX);
-            maxY = std::max(localMaxY, maxY);
-            maxElevation = std::max(localMaxElevation, maxElevation);
+        minX = std::min(localMinX, minX);
+        minY = std::min(localMinY, minY);
+        minElevation = std::min(localMinElevation, minElevation);
+        maxX = std::max(localMaxX, maxX);
+        maxY = std::max(localMaxY, maxY);
+        maxElevation = std::max(localMaxElevation, maxElevation);
 
-            std::cout << "  Global boundaries (all files) updated to:" << std::endl;
-            std::cout << "    X: [" << minX << ", " << maxX << "], Y: [" << minY << ", " << maxY << "], Elevation: [" << minElevation << "," << maxElevation << "]" << std::endl;
+        std::cout << "  Global boundaries (all files) updated to:" << std::endl;
+        std::cout << "    X: [" << minX << ", " << maxX << "], Y: [" << minY << ", " << maxY << "], Elevation: [" << minElevation << "," << maxElevation << "]" << std::endl;
+
+        LineStripSet normalizedStrips;
+        if (onFileScanned && NormalizeScannedStrips(scannedStrips, settings, normalizedStrips))
+        {
+            onFileScanned(normalizedStrips);
         }
+    }
+
+    if (settings->HasBounds)
+    {
+        // Tile exactly the requested area. Contours in the margin normalize to just outside 0-1.
+        minX = settings->BoundsMinX;
+        maxX = settings->BoundsMaxX;
+        minY = settings->BoundsMinY;
+        maxY = settings->BoundsMaxY;
+    }
 
     std::cout << std::endl;
     std::cout << "Global boundaries (all files):" << std::endl;
     std::cout << "  X: [" << minX << ", " << maxX << "], Y: [" << minY << ", " << maxY << "], Elevation: [" << minElevation << "," << maxElevation << "]" << std::endl;
     std::cout << "Statistics: " << std::endl;
-    std::cout << "  Features: " << featureCount << ". Line sets: " << lineSetCount << ". Points: " << pointCount << "." << std::endl;
+    std::cout << "  Features: " << featureCount << ". Line sets: " << lineStripCount << ". Points: " << (isPointCountEstimated ? "at most " : "") << pointCount << "." << std::endl;
     std::cout << std::endl;
+    return true;
+}
 
+bool LineStripLoader::ImportLineStrips(Settings* settings, LineStripSet& importedStrips, std::function<bool(LineStripSet&, LineStrip&)> onLineStrip, std::function<void()> onFileImported)
+{
     long parsedPoints = 0;
-
+    long clampedPoints = 0;
 
     std::cout << "=== Importing Data ===" << std::endl;
     std::set<double> uniqueElevations = std::set<double>();
-    for (std::string geojsonFile : settings->GeoJsonFiles)
+    int fileIndex = 0;
+    for (std::string inputFile : settings->InputFiles)
     {
-        std::ifstream lsf(geojsonFile, std::ios::in | std::ios::binary);
-        std::cout << "Loading GeoJSON file " << geojsonFile << "..." << std::endl;
-        json geoJson;
-        lsf >> geoJson;
-        std::cout << "Loaded GeoJSON file." << std::endl;
+        std::stringstream stage;
+        stage << "Importing file " << (fileIndex + 1) << " of " << settings->InputFiles.size();
+        SetProgress(stage.str(), pointCount == 0 ? 0.0 : (double)parsedPoints / (double)pointCount);
+        ++fileIndex;
 
-        std::cout << "Loading and normalizing features..." << std::endl;
-        for (auto& feature : geoJson["features"])
+        std::cout << "Loading and normalizing the features of " << inputFile << "..." << std::endl;
+        bool isRead = ReadFeatures(settings, inputFile, [&](const ContourFeature& feature)
         {
-            double elevation = 0.0;
-            if (feature["properties"][settings->ElevationFeature.c_str()].is_number_integer())
-            {
-                elevation = int(feature["properties"][settings->ElevationFeature.c_str()].get<int>());
-            }
-            else // if (feature["properties"][settings->ElevationFeature.c_str()].is_number_float())
-            {
-                elevation = feature["properties"][settings->ElevationFeature.c_str()].get<double>();
-            }
-
-            for (auto& lineSet : feature["geometry"]["coordinates"])
+            for (size_t i = 0; i < feature.lineSetCount; i++)
             {
-                lineStrips.push_back(LineStrip());
-                size_t i = lineStrips.size() - 1;
+                const ContourLineSet& lineSet = feature.lineSets[i];
+                if (settings->HasBounds && !IsWithinBounds(lineSet, settings))
+                {
+                    continue;
+                }
 
-                lineStrips[i].elevation = (elevation - minElevation) / (maxElevation - minElevation);
-                uniqueElevations.emplace(lineStrips[i].elevation);
+                LineStrip lineStrip;
+                lineStrip.elevation = (feature.elevation - minElevation) / (maxElevation - minElevation);
+                lineStrip.offset = importedStrips.PointCount();
+                uniqueElevations.emplace(lineStrip.elevation);
 
-                lineStrips[i].points.clear();
-                lineStrips[i].lowResPoints.clear();
-                for (auto& point : lineSet)
+                for (size_t j = 0; j < lineSet.count; j++)
                 {
-                    const double x = point[0];
-                    const double y = point[1];
+                    const Point& point = lineSet.points[j];
                     Point parsedPoint;
-                    parsedPoint.x = (x - minX) / (maxX - minX);
-                    parsedPoint.y = 1.0 - ((y - minY) / (maxY - minY));
+                    parsedPoint.x = (point.x - minX) / (maxX - minX);
+                    parsedPoint.y = 1.0 - ((point.y - minY) / (maxY - minY));
 
-                    if (settings->IsHighResolution)
+                    if (settings->IsQuantized)
                     {
-                        lineStrips[i].points.push_back(parsedPoint);
+                        if (QuantizedPoint::IsOutOfRange(parsedPoint.x) || QuantizedPoint::IsOutOfRange(parsedPoint.y))
+                        {
+                            ++clampedPoints;
+                        }
+
+                        importedStrips.quantizedPoints.push_back(QuantizedPoint(QuantizedPoint::Quantize(parsedPoint.x), QuantizedPoint::Quantize(parsedPoint.y)));
+                    }
+                    else if (settings->IsHighResolution)
+                    {
+                        importedStrips.points.push_back(parsedPoint);
                     }
                     else
                     {
                         LowResPoint lrPoint;
                         lrPoint.x = (float)parsedPoint.x;
                         lrPoint.y = (float)parsedPoint.y;
-                        lineStrips[i].lowResPoints.push_back(lrPoint);
+                        importedStrips.lowResPoints.push_back(lrPoint);
                     }
 
                     ++parsedPoints;
-                    if (parsedPoints % (pointCount / 10) == 0)
+                    if (pointCount / 100 != 0 && parsedPoints % (pointCount / 100) == 0)
+                    {
+                        SetProgress(stage.str(), (double)parsedPoints / (double)pointCount);
+                    }
+
+                    if (pointCount / 10 != 0 && parsedPoints % (pointCount / 10) == 0)
                     {
                         std::cout << "  Point " << parsedPoints << " of " << pointCount << " loaded." << std::endl;
                     }
                 }
+
+                // The callback may shrink the strip, so only its remaining points are kept.
+                lineStrip.count = (uint32_t)(importedStrips.PointCount() - lineStrip.offset);
+                if (onLineStrip(importedStrips, lineStrip))
+                {
+                    importedStrips.Truncate(lineStrip.offset + lineStrip.count);
+                    importedStrips.strips.push_back(lineStrip);
+                }
+                else
+                {
+                    importedStrips.Truncate(lineStrip.offset);
+                }
             }
+
+            return true;
+        });
+
+        if (!isRead)
+        {
+            return false;
+        }
+
+        if (onFileImported)
+        {
+            onFileImported();
         }
     }
 
     // Useful for runtime diagnosis
     std::cout << "Found " << uniqueElevations.size() << " unique elevations in the provided inputs." << std::endl;
+    if (clampedPoints != 0)
+    {
+        std::cout << "Warning: " << clampedPoints << " points were beyond the -4 to 4 normalized range of --Quantized and were clamped to it." << std::endl;
+    }
+
+    return true;
+}
+
+LineSimplifier LineStripLoader::CreateSimplifier(Settings* settings) const
+{
+    // Measure the tolerance in output pixels or source units, undoing the per-axis normalization.
+    double pixelsPerUnit = (double)settings->RegionCount * (double)settings->RegionSize;
+    double scaleX = settings->IsSimplifyToleranceInPixels ? pixelsPerUnit : (maxX - minX);
+    double scaleY = settings->IsSimplifyToleranceInPixels ? pixelsPerUnit : (maxY - minY);
+    return LineSimplifier(settings->SimplifyTolerance, scaleX, scaleY);
+}
+
+bool LineStripLoader::Initialize(Settings* settings, std::function<void(const LineStripSet&)> onFileImported, std::function<void(const LineStripSet&)> onFileScanned)
+{
+    lineStrips.Clear();
+    if (!FindBoundaries(settings, onFileScanned))
+    {
+        return false;
+    }
+
+    // Size the arena up front, unless most of the strips are skipped for being outside of the tile range.
+    if (!settings->HasTileRange)
+    {
+        lineStrips.strips.reserve(lineStripCount);
+        if (settings->IsQuantized)
+        {
+            lineStrips.quantizedPoints.reserve(pointCount);
+        }
+        else if (settings->IsHighResolution)
+        {
+            lineStrips.points.reserve(pointCount);
+        }
+        else
+        {
+            lineStrips.lowResPoints.reserve(pointCount);
+        }
+    }
+
+    int halo = GetTileRangeHalo(settings);
+    if (settings->HasTileRange && halo > settings->BucketHalo)
+    {
+        std::cout << "Keeping contours within " << halo << " tiles of the tile range, the reach of the search, instead of the " << settings->BucketHalo << " tile --BucketHalo." << std::endl;
+    }
+
+    // The R-tree is built from only the kept contours, so it can visit equally distant lines in a different order.
+    if (settings->HasTileRange && settings->IsRTreeIndex)
+    {
+        std::cout << "Warning: with '--Index rtree', ties between equally distant contours may resolve differently than in a single-process export." << std::endl;
+    }
+
+    long skippedLineStrips = 0;
+    bool isImported = ImportLineStrips(settings, lineStrips, [settings, halo, &skippedLineStrips](LineStripSet& importedStrips, LineStrip& lineStrip)
+    {
+        // A process rendering part of the tiles only indexes the contours near its tiles.
+        if (settings->HasTileRange && !IsWithinTileRange(importedStrips, lineStrip, settings, halo))
+        {
+            ++skippedLineStrips;
+            return false;
+        }
+
+        return true;
+    },
+    [this, &onFileImported]()
+    {
+        if (onFileImported)
+        {
+            onFileImported(lineStrips);
+        }
+    });
+
+    if (!isImported)
+    {
+        return false;
+    }
+
+    if (settings->HasTileRange)
+    {
+        std::cout << "Kept " << lineStrips.strips.size() << " line strips near the tile range, skipping " << skippedLineStrips << "." << std::endl;
+        lineStrips.Compact();
+    }
+
+    if (settings->SimplifyTolerance > 0)
+    {
+        SetProgress("Simplifying", 0.0);
+        std::cout << "Simplifying line strips with a tolerance of " << settings->SimplifyTolerance << (settings->IsSimplifyToleranceInPixels ? " pixels..." : " source units...") << std::endl;
+        size_t originalSegments = LineSimplifier::CountSegments(lineStrips);
+        CreateSimplifier(settings).SimplifyAll(lineStrips);
+        size_t simplifiedSegments = LineSimplifier::CountSegments(lineStrips);
+        std::cout << "  Segments: " << originalSegments << " before, " << simplifiedSegments << " after simplification." << std::endl;
+    }
+
+    SetProgress("Loaded", 1.0);
     return true;
 }
 
+bool LineStripLoader::StreamLineStrips(Settings* settings, std::function<void(const LineStripSet&, const LineStrip&)> onLineStrip)
+{
+    lineStrips.Clear();
+    if (!FindBoundaries(settings))
+    {
+        return false;
+    }
+
+    // Each strip is imported into the arena, passed on and then discarded, so the arena only ever holds a single strip.
+    bool isSimplifying = settings->SimplifyTolerance > 0;
+    LineSimplifier simplifier = CreateSimplifier(settings);
+    return ImportLineStrips(settings, lineStrips, [isSimplifying, &simplifier, &onLineStrip](LineStripSet& importedStrips, LineStrip& lineStrip)
+    {
+        if (isSimplifying)
+        {
+            simplifier.Simplify(importedStrips, lineStrip);
+        }
+
+        onLineStrip(importedStrips, lineStrip);
+        return false;
+    });
+}
+
+long LineStripLoader::PointCount() const
+{
+    return pointCount;
+}
+
+double LineStripLoader::ElevationRange() const
+{
+    return maxElevation - minElevation;
+}
+
+void LineStripLoader::CopyElevationRange(const LineStripLoader& other)
+{
+    minElevation = other.minElevation;
+    maxElevation = other.maxElevation;
+}
+
 LineStripLoader::~LineStripLoader()
 {
 }
\ No newline at end of file
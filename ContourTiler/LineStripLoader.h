@@ -1,15 +1,70 @@
 #pragma once
+#include <functional>
+#include <mutex>
 #include <string>
-#include "LineStrip.h"
+#include "LineSimplifier.h"
+#include "LineStripSet.h"
 #include "Settings.h"
 
 class LineStripLoader
 {
+    // Input boundaries, used to normalize the strips to 0-1.
+    double minX, maxX, minY, maxY;
+    double minElevation, maxElevation;
+    long pointCount;
+    long lineStripCount;
+
+    // Description and completed fraction of the current loading stage, for displaying from another thread.
+    mutable std::mutex progressMutex;
+    std::string progressStage;
+    double progressFraction;
+    void SetProgress(const std::string& stage, double fraction);
+
+    // The scanned strips shown while finding the boundaries are thinned to stay within this many points.
+    static const size_t MaxScannedPoints = 1 << 20;
+
+    // Finds the boundaries and validates the inputs, without storing any line strips.
+    // If provided, the callback is called after each file is read with a thinned copy of the strips read so far, normalized within the boundaries found so far.
+    bool FindBoundaries(Settings* settings, std::function<void(const LineStripSet&)> onFileScanned = nullptr);
+
+    // Normalizes strips in source units within the boundaries found so far. Returns false if the boundaries are still empty.
+    bool NormalizeScannedStrips(const LineStripSet& scannedStrips, Settings* settings, LineStripSet& normalizedStrips) const;
+
+    // Normalizes each line strip within the boundaries into the arena, passing it to the callback.
+    // Strips the callback keeps (by returning true) are added to the set, otherwise their points are discarded.
+    // If provided, the file callback is called after each file has been imported. Returns false if a file could not be read.
+    bool ImportLineStrips(Settings* settings, LineStripSet& importedStrips, std::function<bool(LineStripSet&, LineStrip&)> onLineStrip, std::function<void()> onFileImported = nullptr);
+
+    // Creates the simplifier for the requested tolerance in pixels or source units.
+    LineSimplifier CreateSimplifier(Settings* settings) const;
+
 public:
     LineStripLoader();
 
-    std::vector<LineStrip> lineStrips;
-    bool Initialize(Settings* settings);
+    LineStripSet lineStrips;
+
+    // Loads all the line strips. If provided, the import callback is called with the strips imported so far after each file is imported,
+    // and the scan callback with a preview of the strips read so far after each file is read while finding the boundaries.
+    bool Initialize(Settings* settings, std::function<void(const LineStripSet&)> onFileImported = nullptr, std::function<void(const LineStripSet&)> onFileScanned = nullptr);
+
+    // Loads each normalized (and if requested, simplified) line strip, passing it to the callback instead of storing it.
+    // The points of each strip are only valid during the callback.
+    bool StreamLineStrips(Settings* settings, std::function<void(const LineStripSet&, const LineStrip&)> onLineStrip);
+
+    // Returns how many tiles of surrounding contours a tile range keeps: --BucketHalo, raised to the reach of the search if needed.
+    static int GetTileRangeHalo(const Settings* settings);
+
+    // Returns the number of points within the boundaries, after the boundaries have been found.
+    long PointCount() const;
+
+    // Returns the difference between the highest and lowest input elevations, which are normalized to 0-1.
+    double ElevationRange() const;
+
+    // Uses the elevation range of another loader, for loaders holding line strips that it normalized.
+    void CopyElevationRange(const LineStripLoader& other);
+
+    // Gets the description and completed fraction (0-1) of the current loading stage. Safe to call while loading.
+    void GetProgress(std::string* stage, double* fraction) const;
 
     virtual ~LineStripLoader();
 };
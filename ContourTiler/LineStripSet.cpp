@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <limits>
+#include "LineStripSet.h"
+
+void LineStripSet::Clear()
+{
+    strips.clear();
+    points.clear();
+    lowResPoints.clear();
+    quantizedPoints.clear();
+}
+
+size_t LineStripSet::PointCount() const
+{
+    return points.size() + lowResPoints.size() + quantizedPoints.size();
+}
+
+void LineStripSet::Truncate(size_t pointCount)
+{
+    points.resize(std::min(points.size(), pointCount));
+    lowResPoints.resize(std::min(lowResPoints.size(), pointCount));
+    quantizedPoints.resize(std::min(quantizedPoints.size(), pointCount));
+}
+
+template <typename T>
+void LineStripSet::GetBounds(const T* stripPoints, uint32_t count, double* minX, double* minY, double* maxX, double* maxY) const
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        Point point = ToPoint(stripPoints[i]);
+        *minX = std::min(point.x, *minX);
+        *minY = std::min(point.y, *minY);
+        *maxX = std::max(point.x, *maxX);
+        *maxY = std::max(point.y, *maxY);
+    }
+}
+
+void LineStripSet::GetBounds(const LineStrip& strip, double* minX, double* minY, double* maxX, double* maxY) const
+{
+    *minX = std::numeric_limits<double>::max();
+    *minY = std::numeric_limits<double>::max();
+    *maxX = std::numeric_limits<double>::lowest();
+    *maxY = std::numeric_limits<double>::lowest();
+    if (!points.empty())
+    {
+        GetBounds(GetPoints<Point>(strip), strip.count, minX, minY, maxX, maxY);
+    }
+    else if (!lowResPoints.empty())
+    {
+        GetBounds(GetPoints<LowResPoint>(strip), strip.count, minX, minY, maxX, maxY);
+    }
+    else if (!quantizedPoints.empty())
+    {
+        GetBounds(GetPoints<QuantizedPoint>(strip), strip.count, minX, minY, maxX, maxY);
+    }
+}
+
+template <typename T>
+void LineStripSet::CompactArena(std::vector<T>& arena)
+{
+    // Strips are stored in arena order, so each move is to an earlier (or the same) position.
+    size_t compactedPoints = 0;
+    for (LineStrip& strip : strips)
+    {
+        if (strip.offset != compactedPoints)
+        {
+            std::copy(arena.begin() + strip.offset, arena.begin() + strip.offset + strip.count, arena.begin() + compactedPoints);
+            strip.offset = compactedPoints;
+        }
+
+        compactedPoints += strip.count;
+    }
+
+    arena.resize(compactedPoints);
+    arena.shrink_to_fit();
+}
+
+void LineStripSet::Compact()
+{
+    if (!points.empty())
+    {
+        CompactArena(points);
+    }
+    else if (!lowResPoints.empty())
+    {
+        CompactArena(lowResPoints);
+    }
+    else if (!quantizedPoints.empty())
+    {
+        CompactArena(quantizedPoints);
+    }
+}
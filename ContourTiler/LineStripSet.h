@@ -0,0 +1,139 @@
+#pragma once
+#include <vector>
+#include "Index.h"
+#include "LineStrip.h"
+#include "Point.h"
+
+// Line strips with all of their points stored in a single arena, instead of a vector per strip.
+// Only the arena of the resolution in use is populated.
+class LineStripSet
+{
+    template <typename T>
+    void CompactArena(std::vector<T>& arena);
+
+    template <typename T>
+    void GetBounds(const T* stripPoints, uint32_t count, double* minX, double* minY, double* maxX, double* maxY) const;
+
+public:
+    // The format the points are stored in, which decides the arena in use.
+    enum class PointType
+    {
+        Full,
+        LowRes,
+        Quantized
+    };
+
+    std::vector<LineStrip> strips;
+    std::vector<Point> points;
+    std::vector<LowResPoint> lowResPoints;
+    std::vector<QuantizedPoint> quantizedPoints;
+
+    void Clear();
+
+    // Returns the number of points in the arena, including any not used by a strip.
+    size_t PointCount() const;
+
+    // Discards the points in the arena after the first [pointCount].
+    void Truncate(size_t pointCount);
+
+    // Gets the bounding box of a line strip, in normalized coordinates.
+    void GetBounds(const LineStrip& strip, double* minX, double* minY, double* maxX, double* maxY) const;
+
+    // Moves the points of each strip next to the previous strip, removing the gaps left by strips that have shrunk.
+    void Compact();
+
+    // Hot loops check this once, then read the arena of that type directly with GetStoredSegment.
+    PointType GetPointType() const
+    {
+        if (!quantizedPoints.empty())
+        {
+            return PointType::Quantized;
+        }
+
+        return points.empty() ? PointType::LowRes : PointType::Full;
+    }
+
+    // Gets the segment from the indexed point to the next as stored, from the arena of type T.
+    template <typename T>
+    void GetStoredSegment(Index index, T* start, T* end) const
+    {
+        const T* point = GetArena<T>().data() + strips[index.stripIdx].offset + index.pointIdx;
+        *start = point[0];
+        *end = point[1];
+    }
+
+    // Gets the normalized start and end of the segment from the indexed point to the next.
+    void GetSegment(Index index, Point* start, Point* end) const
+    {
+        size_t point = strips[index.stripIdx].offset + index.pointIdx;
+        if (!points.empty())
+        {
+            *start = points[point];
+            *end = points[point + 1];
+        }
+        else if (!lowResPoints.empty())
+        {
+            *start = ToPoint(lowResPoints[point]);
+            *end = ToPoint(lowResPoints[point + 1]);
+        }
+        else
+        {
+            *start = ToPoint(quantizedPoints[point]);
+            *end = ToPoint(quantizedPoints[point + 1]);
+        }
+    }
+
+    template <typename T>
+    std::vector<T>& GetArena();
+
+    template <typename T>
+    const std::vector<T>& GetArena() const;
+
+    template <typename T>
+    T* GetPoints(const LineStrip& strip)
+    {
+        return GetArena<T>().data() + strip.offset;
+    }
+
+    template <typename T>
+    const T* GetPoints(const LineStrip& strip) const
+    {
+        return GetArena<T>().data() + strip.offset;
+    }
+};
+
+template <>
+inline std::vector<Point>& LineStripSet::GetArena<Point>()
+{
+    return points;
+}
+
+template <>
+inline std::vector<LowResPoint>& LineStripSet::GetArena<LowResPoint>()
+{
+    return lowResPoints;
+}
+
+template <>
+inline std::vector<QuantizedPoint>& LineStripSet::GetArena<QuantizedPoint>()
+{
+    return quantizedPoints;
+}
+
+template <>
+inline const std::vector<Point>& LineStripSet::GetArena<Point>() const
+{
+    return points;
+}
+
+template <>
+inline const std::vector<LowResPoint>& LineStripSet::GetArena<LowResPoint>() const
+{
+    return lowResPoints;
+}
+
+template <>
+inline const std::vector<QuantizedPoint>& LineStripSet::GetArena<QuantizedPoint>() const
+{
+    return quantizedPoints;
+}
@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <cmath>
+#include "ElevationComputer.h"
+#include "LoadingPreview.h"
+
+LoadingPreview::LoadingPreview(int size)
+    : size(size), index(size), indexedStripCount(0)
+{ }
+
+void LoadingPreview::AddLineStrips(const LineStripSet& lineStrips)
+{
+    index.AddLineStrips(&lineStrips, indexedStripCount);
+    indexedStripCount = lineStrips.strips.size();
+}
+
+void LoadingPreview::Rasterize(double leftOffset, double topOffset, double effectiveSize, int step, double* rasterStore) const
+{
+    for (int j = 0; j < size; j += step)
+    {
+        for (int i = 0; i < size; i += step)
+        {
+            Point point(leftOffset + ((double)i / (double)size) * effectiveSize, topOffset + ((double)j / (double)size) * effectiveSize);
+            ElevationComputer elevationComputer(point);
+            index.Search(point, elevationComputer, nullptr);
+
+            // Nothing may have loaded near the point yet.
+            double elevation = elevationComputer.PopulatedRegionCount() == 0 ? 0.0 : elevationComputer.GetWeightedElevation();
+            for (int y = j; y < std::min(j + step, size); y++)
+            {
+                std::fill(rasterStore + i + y * size, rasterStore + std::min(i + step, size) + y * size, elevation);
+            }
+        }
+    }
+}
+
+void LoadingPreview::DrawLines(const LineStripSet& lineStrips, double leftOffset, double topOffset, double effectiveSize, int size, double* rasterStore)
+{
+    for (size_t i = 0; i < lineStrips.strips.size(); i++)
+    {
+        const LineStrip& lineStrip = lineStrips.strips[i];
+        for (uint32_t j = 0; j + 1 < lineStrip.count; j++)
+        {
+            Point start, end;
+            lineStrips.GetSegment(Index((int)i, (int)j), &start, &end);
+
+            double startX = (start.x - leftOffset) / effectiveSize * (double)size;
+            double startY = (start.y - topOffset) / effectiveSize * (double)size;
+            double endX = (end.x - leftOffset) / effectiveSize * (double)size;
+            double endY = (end.y - topOffset) / effectiveSize * (double)size;
+            int steps = (int)std::min(std::max(std::abs(endX - startX), std::abs(endY - startY)), (double)(size * 2)) + 1;
+            for (int k = 0; k <= steps; k++)
+            {
+                int x = (int)(startX + (endX - startX) * (double)k / (double)steps);
+                int y = (int)(startY + (endY - startY) * (double)k / (double)steps);
+                if (x >= 0 && y >= 0 && x < size && y < size)
+                {
+                    rasterStore[x + y * size] = lineStrip.elevation;
+                }
+            }
+        }
+    }
+}
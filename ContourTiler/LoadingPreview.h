@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+#include "GridIndex.h"
+#include "LineStripSet.h"
+
+// Coarsely rasterizes the line strips while they load, so the display shows the data long before the full index is built.
+class LoadingPreview
+{
+    int size;
+
+    // Grid over the strips loaded so far, which grows with each call to AddLineStrips.
+    GridIndex index;
+    size_t indexedStripCount;
+
+public:
+    LoadingPreview(int size);
+
+    // Indexes the strips added to the set since the last call. The set must not change while the preview is rasterized.
+    void AddLineStrips(const LineStripSet& lineStrips);
+
+    // Rasterizes every [step]th pixel of the view from the strips indexed so far into a [size]x[size] store, filling the square of pixels each starts.
+    void Rasterize(double leftOffset, double topOffset, double effectiveSize, int step, double* rasterStore) const;
+
+    // Draws the segments of the strips in the view into a [size]x[size] store, shaded by their elevation.
+    static void DrawLines(const LineStripSet& lineStrips, double leftOffset, double topOffset, double effectiveSize, int size, double* rasterStore);
+};
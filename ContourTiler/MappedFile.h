@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// A read-only memory mapping of a whole file, so inputs are read straight from the page cache without being copied.
+class MappedFile
+{
+    const char* data;
+    size_t size;
+
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#else
+    int fileDescriptor;
+#endif
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+public:
+    MappedFile();
+
+    // Maps the file, replacing any file already mapped. Returns false if the file can't be opened or mapped.
+    bool Open(const std::string& file);
+    void Close();
+
+    // The contents of the file, valid until it is closed. Empty files have no data.
+    const char* Data() const;
+    size_t Size() const;
+
+    ~MappedFile();
+};
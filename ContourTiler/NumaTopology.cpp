@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#ifdef _WIN32
+    #define NOMINMAX
+    #include <windows.h>
+#elif defined(__linux__)
+    #include <dirent.h>
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+#include "NumaTopology.h"
+
+static thread_local int currentNode = -1;
+
+NumaTopology::NumaTopology()
+    : nodes()
+{
+#ifdef _WIN32
+    ULONG highestNode = 0;
+    if (GetNumaHighestNodeNumber(&highestNode))
+    {
+        for (ULONG i = 0; i <= highestNode; i++)
+        {
+            GROUP_AFFINITY affinity;
+            if (!GetNumaNodeProcessorMaskEx((USHORT)i, &affinity) || affinity.Mask == 0)
+            {
+                continue;
+            }
+
+            Node node;
+            node.group = (int)affinity.Group;
+            for (int j = 0; j < (int)(sizeof(KAFFINITY) * 8); j++)
+            {
+                if ((affinity.Mask & ((KAFFINITY)1 << j)) != 0)
+                {
+                    node.processors.push_back(j);
+                }
+            }
+
+            nodes.push_back(node);
+        }
+    }
+#elif defined(__linux__)
+    // Node folders may not be numbered contiguously, so all are listed.
+    std::vector<int> nodeIds;
+    DIR* directory = opendir("/sys/devices/system/node");
+    if (directory != nullptr)
+    {
+        dirent* entry;
+        while ((entry = readdir(directory)) != nullptr)
+        {
+            int nodeId;
+            char suffix;
+            if (std::sscanf(entry->d_name, "node%d%c", &nodeId, &suffix) == 1)
+            {
+                nodeIds.push_back(nodeId);
+            }
+        }
+
+        closedir(directory);
+    }
+
+    std::sort(nodeIds.begin(), nodeIds.end());
+    for (int nodeId : nodeIds)
+    {
+        std::ifstream processorFile("/sys/devices/system/node/node" + std::to_string(nodeId) + "/cpulist");
+        std::string processorList;
+        Node node;
+        node.group = 0;
+
+        // Nodes with only memory have an empty processor list.
+        if (std::getline(processorFile, processorList) && ParseProcessorList(processorList.c_str(), node.processors) && !node.processors.empty())
+        {
+            nodes.push_back(node);
+        }
+    }
+#endif
+
+    if (nodes.empty())
+    {
+        Node node;
+        node.group = 0;
+        int processorCount = std::max(1, (int)std::thread::hardware_concurrency());
+        for (int i = 0; i < processorCount; i++)
+        {
+            node.processors.push_back(i);
+        }
+
+        nodes.push_back(node);
+    }
+}
+
+bool NumaTopology::ParseProcessorList(const char* processorList, std::vector<int>& processors)
+{
+    const char* position = processorList;
+    while (*position != '\0' && *position != '\n')
+    {
+        char* end;
+        long first = std::strtol(position, &end, 10);
+        if (end == position)
+        {
+            return false;
+        }
+
+        long last = first;
+        position = end;
+        if (*position == '-')
+        {
+            ++position;
+            last = std::strtol(position, &end, 10);
+            if (end == position || last < first)
+            {
+                return false;
+            }
+
+            position = end;
+        }
+
+        for (long i = first; i <= last; i++)
+        {
+            processors.push_back((int)i);
+        }
+
+        if (*position == ',')
+        {
+            ++position;
+        }
+    }
+
+    return true;
+}
+
+int NumaTopology::NodeCount() const
+{
+    return (int)nodes.size();
+}
+
+int NumaTopology::ProcessorCount(int node) const
+{
+    return (int)nodes[node].processors.size();
+}
+
+bool NumaTopology::PinThread(int node) const
+{
+    currentNode = node;
+
+#ifdef _WIN32
+    GROUP_AFFINITY affinity = {};
+    affinity.Group = (WORD)nodes[node].group;
+    for (int processor : nodes[node].processors)
+    {
+        affinity.Mask |= (KAFFINITY)1 << processor;
+    }
+
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+#elif defined(__linux__)
+    cpu_set_t processorSet;
+    CPU_ZERO(&processorSet);
+    for (int processor : nodes[node].processors)
+    {
+        if (processor < CPU_SETSIZE)
+        {
+            CPU_SET(processor, &processorSet);
+        }
+    }
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(processorSet), &processorSet) == 0;
+#else
+    return false;
+#endif
+}
+
+int NumaTopology::CurrentNode()
+{
+    return currentNode;
+}
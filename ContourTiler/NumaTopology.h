@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+
+// The NUMA nodes of the machine and the processors of each, for keeping threads next to the memory they read.
+// Machines without NUMA (or where it can't be detected) are treated as a single node holding every processor.
+class NumaTopology
+{
+    struct Node
+    {
+        // Processor group on Windows, always 0 elsewhere.
+        int group;
+        std::vector<int> processors;
+    };
+
+    std::vector<Node> nodes;
+
+    // Parses a Linux processor list such as '0-7,16-23'.
+    static bool ParseProcessorList(const char* processorList, std::vector<int>& processors);
+
+public:
+    // Detects the nodes with processors.
+    NumaTopology();
+
+    int NodeCount() const;
+    int ProcessorCount(int node) const;
+
+    // Pins the calling thread to the processors of the node, and records the node for CurrentNode.
+    // Memory the thread first writes to is then (by default) allocated on the node.
+    bool PinThread(int node) const;
+
+    // Returns the node the calling thread was pinned to, or -1 if it has not been pinned.
+    static int CurrentNode();
+};
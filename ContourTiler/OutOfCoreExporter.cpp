@@ -0,0 +1,511 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include "GridIndex.h"
+#include "Index.h"
+#include "OutOfCoreExporter.h"
+#include "RasterCost.h"
+#include "Rasterizer.h"
+
+OutOfCoreExporter::OutOfCoreExporter()
+    : settings(nullptr), tileWriter(), tileManifest(), tilePyramid(), bucketFolder(), bucketCount(1), tilesPerBucket(1), bucketHalo(1), indexCountEntries(GridIndex::DefaultMaxCountEntries), bucketBuffers(), flushSize(0)
+{ }
+
+void OutOfCoreExporter::ChooseBucketCount(long pointCount)
+{
+    double budgetBytes = (double)settings->MemoryBudget * 1024.0 * 1024.0;
+
+    // Building a grid index counts its entries in at most an eighth of the budget, with fewer threads counting in parallel for small budgets.
+    indexCountEntries = (size_t)std::min((double)GridIndex::DefaultMaxCountEntries, budgetBytes / (8.0 * (double)sizeof(size_t)));
+
+    // Rough per-point cost of the points, their index entries (each segment lands in ~3 squares) and the level of detail copies.
+    double bytesPerPoint = (double)((settings->IsHighResolution && !settings->IsQuantized ? sizeof(Point) : sizeof(LowResPoint)) + 3 * sizeof(Index)) * (double)settings->LodLevels;
+
+    // The squares of every level's index, the counts of the level being built, and the raster of a single tile.
+    double rasterBytes = (double)settings->RegionSize * (double)settings->RegionSize * (double)(sizeof(double) + (settings->ExportCostMaps ? sizeof(RasterCost) : 0));
+    double fixedBytes = GridIndex::GetSquareBytes(settings->RegionSize) * (double)settings->LodLevels + GridIndex::GetBuildBytes(settings->RegionSize, indexCountEntries) + rasterBytes;
+
+    double bucketBytes = 0.0;
+    for (bucketCount = 1; bucketCount <= settings->RegionCount; bucketCount++)
+    {
+        tilesPerBucket = (settings->RegionCount + bucketCount - 1) / bucketCount;
+
+        // Assumes the points are spread evenly, which holds reasonably well for contours.
+        double bucketFraction = std::min(1.0, (double)(tilesPerBucket + 2 * bucketHalo) / (double)settings->RegionCount);
+        bucketBytes = (double)pointCount * bucketFraction * bucketFraction * bytesPerPoint + fixedBytes;
+        if (bucketBytes <= budgetBytes)
+        {
+            break;
+        }
+    }
+
+    if (bucketBytes > budgetBytes)
+    {
+        bucketCount = settings->RegionCount;
+        std::cout << "Warning: buckets of a single tile need about " << (long)std::ceil(bucketBytes / (1024.0 * 1024.0)) << " MiB, more than the " << settings->MemoryBudget << " MiB --MemoryBudget." << std::endl;
+    }
+
+    tilesPerBucket = (settings->RegionCount + bucketCount - 1) / bucketCount;
+    bucketCount = (settings->RegionCount + tilesPerBucket - 1) / tilesPerBucket;
+
+    // Keep a quarter of the budget for the pending bucket writes.
+    flushSize = (size_t)std::max(64.0 * 1024.0, std::min(4.0 * 1024.0 * 1024.0, budgetBytes / (4.0 * bucketCount * bucketCount)));
+}
+
+std::string OutOfCoreExporter::GetBucketFileName(int bucketX, int bucketY) const
+{
+    std::stringstream file;
+    file << bucketFolder.c_str() << "/" << bucketX << "_" << bucketY << ".bucket";
+    return file.str();
+}
+
+bool OutOfCoreExporter::IsBucketInRange(int bucketX, int bucketY) const
+{
+    return (bucketX + 1) * tilesPerBucket > settings->TileRangeMinX && bucketX * tilesPerBucket <= settings->TileRangeMaxX &&
+        (bucketY + 1) * tilesPerBucket > settings->TileRangeMinY && bucketY * tilesPerBucket <= settings->TileRangeMaxY;
+}
+
+void OutOfCoreExporter::GetBucketArea(int bucketX, int bucketY, double* originX, double* originY, double* extent) const
+{
+    // Clamped to the tiled area so that a single bucket matches the in-memory rasterization exactly.
+    *originX = std::max(0.0, (double)(bucketX * tilesPerBucket - bucketHalo) / (double)settings->RegionCount);
+    *originY = std::max(0.0, (double)(bucketY * tilesPerBucket - bucketHalo) / (double)settings->RegionCount);
+    double endX = std::min(1.0, (double)((bucketX + 1) * tilesPerBucket + bucketHalo) / (double)settings->RegionCount);
+    double endY = std::min(1.0, (double)((bucketY + 1) * tilesPerBucket + bucketHalo) / (double)settings->RegionCount);
+
+    // The area must be square so that scaling it to 0-1 is uniform.
+    *extent = std::max(endX - *originX, endY - *originY);
+}
+
+// Appends the raw bytes of a value to the buffer.
+template <typename T>
+static void AppendValue(std::vector<char>& buffer, const T& value)
+{
+    const char* bytes = (const char*)&value;
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+// Appends the raw bytes of the points to the buffer.
+template <typename T>
+static void AppendPoints(std::vector<char>& buffer, const T* points, uint32_t count)
+{
+    const char* bytes = (const char*)points;
+    buffer.insert(buffer.end(), bytes, bytes + count * sizeof(T));
+}
+
+bool OutOfCoreExporter::AddToBuckets(const LineStripSet& lineStrips, const LineStrip& lineStrip)
+{
+    double minX, minY, maxX, maxY;
+    lineStrips.GetBounds(lineStrip, &minX, &minY, &maxX, &maxY);
+
+    // Buckets (with the halo) overlapped by the line strip bounding box.
+    double bucketSize = (double)tilesPerBucket / (double)settings->RegionCount;
+    double haloSize = (double)bucketHalo / (double)settings->RegionCount;
+    int startX = std::max(0, (int)std::floor((minX - haloSize) / bucketSize));
+    int endX = std::min(bucketCount - 1, (int)std::floor((maxX + haloSize) / bucketSize));
+    int startY = std::max(0, (int)std::floor((minY - haloSize) / bucketSize));
+    int endY = std::min(bucketCount - 1, (int)std::floor((maxY + haloSize) / bucketSize));
+
+    for (int bucketY = startY; bucketY <= endY; bucketY++)
+    {
+        for (int bucketX = startX; bucketX <= endX; bucketX++)
+        {
+            if (!IsBucketInRange(bucketX, bucketY))
+            {
+                continue;
+            }
+
+            int bucket = bucketX + bucketY * bucketCount;
+            std::vector<char>& buffer = bucketBuffers[bucket];
+            AppendValue(buffer, lineStrip.elevation);
+            AppendValue(buffer, lineStrip.count);
+            if (settings->IsQuantized)
+            {
+                AppendPoints(buffer, lineStrips.GetPoints<QuantizedPoint>(lineStrip), lineStrip.count);
+            }
+            else if (settings->IsHighResolution)
+            {
+                AppendPoints(buffer, lineStrips.GetPoints<Point>(lineStrip), lineStrip.count);
+            }
+            else
+            {
+                AppendPoints(buffer, lineStrips.GetPoints<LowResPoint>(lineStrip), lineStrip.count);
+            }
+
+            if (buffer.size() >= flushSize && !FlushBucket(bucket))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool OutOfCoreExporter::FlushBucket(int bucket)
+{
+    std::vector<char>& buffer = bucketBuffers[bucket];
+    if (buffer.empty())
+    {
+        return true;
+    }
+
+    std::ofstream bucketFile(GetBucketFileName(bucket % bucketCount, bucket / bucketCount), std::ios::out | std::ios::binary | std::ios::app);
+    bucketFile.write(&buffer[0], buffer.size());
+
+    // Release the memory, not just the contents.
+    std::vector<char>().swap(buffer);
+    if (!bucketFile)
+    {
+        std::cout << "Unable to write to the bucket file " << GetBucketFileName(bucket % bucketCount, bucket / bucketCount) << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void OutOfCoreExporter::AddQuantizedStrips(const std::vector<Point>& points, double elevation, LineStripSet& lineStrips) const
+{
+    // A single point has no segments to bend.
+    if (points.size() == 1)
+    {
+        lineStrips.strips.push_back(LineStrip(elevation, lineStrips.PointCount(), 1));
+        lineStrips.quantizedPoints.push_back(QuantizedPoint(QuantizedPoint::Quantize(points[0].x), QuantizedPoint::Quantize(points[0].y)));
+        return;
+    }
+
+    // Kept clear of the edge of the fixed point range, so that the clipped ends are stored without clamping.
+    const double limit = 3.99;
+    bool isStripOpen = false;
+    for (size_t i = 0; i + 1 < points.size(); i++)
+    {
+        Point start = points[i];
+        Point end = points[i + 1];
+        if (!ClipSegment(-limit, limit, &start, &end))
+        {
+            isStripOpen = false;
+            continue;
+        }
+
+        // Segments that leave the range end the strip, and those that enter it start a new one.
+        bool isStartClipped = start.x != points[i].x || start.y != points[i].y;
+        if (!isStripOpen || isStartClipped)
+        {
+            lineStrips.strips.push_back(LineStrip(elevation, lineStrips.PointCount(), 1));
+            lineStrips.quantizedPoints.push_back(QuantizedPoint(QuantizedPoint::Quantize(start.x), QuantizedPoint::Quantize(start.y)));
+        }
+
+        ++lineStrips.strips.back().count;
+        lineStrips.quantizedPoints.push_back(QuantizedPoint(QuantizedPoint::Quantize(end.x), QuantizedPoint::Quantize(end.y)));
+        isStripOpen = end.x == points[i + 1].x && end.y == points[i + 1].y;
+    }
+}
+
+bool OutOfCoreExporter::LoadBucket(int bucketX, int bucketY, LineStripLoader* bucketStrips)
+{
+    LineStripSet& lineStrips = bucketStrips->lineStrips;
+    lineStrips.Clear();
+
+    std::string fileName = GetBucketFileName(bucketX, bucketY);
+    std::ifstream bucketFile(fileName, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!bucketFile)
+    {
+        // No contours were near this bucket.
+        return true;
+    }
+
+    // Point counts are checked against the rest of the file, so a corrupt count can't allocate more than the file holds.
+    long long fileSize = (long long)bucketFile.tellg();
+    bucketFile.seekg(0);
+    size_t pointSize = settings->IsQuantized ? sizeof(QuantizedPoint) : (settings->IsHighResolution ? sizeof(Point) : sizeof(LowResPoint));
+
+    // Uniformly scaling the bucket area to 0-1 leaves the angles and relative distances, and so the interpolation, unchanged.
+    double originX, originY, extent;
+    GetBucketArea(bucketX, bucketY, &originX, &originY, &extent);
+
+    LineStrip lineStrip;
+    std::vector<QuantizedPoint> storedPoints;
+    std::vector<Point> bucketPoints;
+    bool isCorrupt = false;
+    while (bucketFile.read((char*)&lineStrip.elevation, sizeof(lineStrip.elevation)))
+    {
+        if (!bucketFile.read((char*)&lineStrip.count, sizeof(lineStrip.count)) ||
+            (long long)lineStrip.count * (long long)pointSize > fileSize - (long long)bucketFile.tellg())
+        {
+            isCorrupt = true;
+            break;
+        }
+
+        if (settings->IsQuantized)
+        {
+            // Far away vertices of long strips can be outside of the fixed point range relative to the bucket.
+            // Clamping them would bend the segments reaching into the bucket, so the strips are clipped to the range instead.
+            storedPoints.resize(lineStrip.count);
+            if (!bucketFile.read((char*)storedPoints.data(), lineStrip.count * sizeof(QuantizedPoint)))
+            {
+                isCorrupt = true;
+                break;
+            }
+
+            bucketPoints.resize(lineStrip.count);
+            for (uint32_t i = 0; i < lineStrip.count; i++)
+            {
+                Point point = ToPoint(storedPoints[i]);
+                bucketPoints[i] = Point((point.x - originX) / extent, (point.y - originY) / extent);
+            }
+
+            AddQuantizedStrips(bucketPoints, lineStrip.elevation, lineStrips);
+            continue;
+        }
+
+        lineStrip.offset = lineStrips.PointCount();
+        lineStrips.strips.push_back(lineStrip);
+        if (settings->IsHighResolution)
+        {
+            lineStrips.points.resize(lineStrip.offset + lineStrip.count);
+            Point* points = lineStrips.GetPoints<Point>(lineStrip);
+            if (!bucketFile.read((char*)points, lineStrip.count * sizeof(Point)))
+            {
+                isCorrupt = true;
+                break;
+            }
+
+            for (uint32_t i = 0; i < lineStrip.count; i++)
+            {
+                points[i].x = (points[i].x - originX) / extent;
+                points[i].y = (points[i].y - originY) / extent;
+            }
+        }
+        else
+        {
+            lineStrips.lowResPoints.resize(lineStrip.offset + lineStrip.count);
+            LowResPoint* points = lineStrips.GetPoints<LowResPoint>(lineStrip);
+            if (!bucketFile.read((char*)points, lineStrip.count * sizeof(LowResPoint)))
+            {
+                isCorrupt = true;
+                break;
+            }
+
+            for (uint32_t i = 0; i < lineStrip.count; i++)
+            {
+                points[i].x = (float)(((double)points[i].x - originX) / extent);
+                points[i].y = (float)(((double)points[i].y - originY) / extent);
+            }
+        }
+    }
+
+    // A partial strip header also ends the loop, but unlike the end of the file leaves some bytes read.
+    if (isCorrupt || bucketFile.gcount() != 0)
+    {
+        std::cout << "The bucket file " << fileName << " is truncated or corrupt!" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool OutOfCoreExporter::RasterizeBucket(int bucketX, int bucketY, const LineStripLoader& lineStripLoader)
+{
+    LineStripLoader bucketStrips;
+    if (!LoadBucket(bucketX, bucketY, &bucketStrips))
+    {
+        return false;
+    }
+
+    bucketStrips.CopyElevationRange(lineStripLoader);
+    std::cout << "Bucket " << bucketX << ", " << bucketY << ": " << bucketStrips.lineStrips.strips.size() << " line strips." << std::endl;
+    Rasterizer rasterizer(&bucketStrips);
+    rasterizer.SetMaxIndexCountEntries(indexCountEntries);
+    rasterizer.Setup(settings);
+
+    double originX, originY, extent;
+    GetBucketArea(bucketX, bucketY, &originX, &originY, &extent);
+
+    std::vector<double> rasterStore(settings->RegionSize * settings->RegionSize);
+    double* rasterizationBuffer = &rasterStore[0];
+    std::vector<RasterCost> costStore(settings->ExportCostMaps ? settings->RegionSize * settings->RegionSize : 0);
+
+    double viewSize = 1.0 / (double)settings->RegionCount;
+    int endY = std::min((bucketY + 1) * tilesPerBucket, settings->RegionCount);
+    int endX = std::min((bucketX + 1) * tilesPerBucket, settings->RegionCount);
+    for (int regionY = bucketY * tilesPerBucket; regionY < endY; regionY++)
+    {
+        for (int regionX = bucketX * tilesPerBucket; regionX < endX; regionX++)
+        {
+            if (!settings->IsTileInRange(regionX, regionY))
+            {
+                continue;
+            }
+
+            // Convert the region to coordinates relative to the bucket area.
+            double leftOffset = ((double)regionX * viewSize - originX) / extent;
+            double topOffset = ((double)regionY * viewSize - originY) / extent;
+
+            auto startTime = std::chrono::steady_clock::now();
+            rasterizer.Rasterize(leftOffset, topOffset, viewSize / extent, &rasterizationBuffer, settings->ExportCostMaps ? &costStore[0] : nullptr);
+            std::chrono::duration<double> rasterTime = std::chrono::steady_clock::now() - startTime;
+            std::cout << "Raster time: " << rasterTime.count() << " s." << std::endl;
+
+            if (!tileWriter.WriteHeightTile(regionX, regionY, rasterizationBuffer))
+            {
+                return false;
+            }
+
+            if (settings->IsBuildingPyramid && !tilePyramid.AddTile(regionX, regionY, rasterizationBuffer))
+            {
+                return false;
+            }
+
+            if (settings->ExportCostMaps)
+            {
+                tileWriter.WriteCostTile(regionX, regionY, &costStore[0]);
+            }
+
+            tileManifest.AddTile(regionX, regionY);
+        }
+    }
+
+    return true;
+}
+
+bool OutOfCoreExporter::Export(Settings* settings)
+{
+    this->settings = settings;
+    tileWriter.Setup(settings);
+    tileManifest.Setup(settings, &tileWriter);
+
+    if (!tileWriter.CreateOutputFolder())
+    {
+        return false;
+    }
+
+    for (int regionY = settings->TileRangeMinY; regionY <= settings->TileRangeMaxY; regionY++)
+    {
+        if (!tileWriter.CreateRowFolder(regionY))
+        {
+            return false;
+        }
+    }
+
+    if (settings->IsBuildingPyramid && !tilePyramid.Setup(settings, &tileWriter))
+    {
+        return false;
+    }
+
+    // Shards sharing an output folder each need their own buckets.
+    std::stringstream bucketFolderName;
+    bucketFolderName << settings->OutputFolder.c_str() << "_buckets";
+    if (settings->HasTileRange)
+    {
+        bucketFolderName << "_" << settings->TileRangeMinX << "_" << settings->TileRangeMinY << "_" << settings->TileRangeMaxX << "_" << settings->TileRangeMaxY;
+    }
+
+    bucketFolder = bucketFolderName.str();
+    if (!TileWriter::CreateFolder(bucketFolder))
+    {
+        return false;
+    }
+
+    // Each bucket's index reaches no further than an index of the whole area, so holding the contours within its reach is enough.
+    bucketHalo = LineStripLoader::GetTileRangeHalo(settings);
+    if (bucketHalo > settings->BucketHalo)
+    {
+        std::cout << "Using a bucket halo of " << bucketHalo << " tiles, the reach of the search, instead of the " << settings->BucketHalo << " tile --BucketHalo." << std::endl;
+    }
+
+    // Stream the contours into the buckets. The line strips are never all held in memory at once.
+    std::cout << "=== Bucketing Data ===" << std::endl;
+    LineStripLoader lineStripLoader;
+    bool bucketsSized = false;
+    bool bucketsWritten = true;
+    bool streamed = lineStripLoader.StreamLineStrips(settings, [&](const LineStripSet& lineStrips, const LineStrip& lineStrip)
+    {
+        // Nothing more is bucketed once a write has failed, as the export is abandoned.
+        if (!bucketsWritten)
+        {
+            return;
+        }
+
+        if (!bucketsSized)
+        {
+            // The boundaries pass has completed when the first strip arrives.
+            ChooseBucketCount(lineStripLoader.PointCount());
+            bucketBuffers.resize(bucketCount * bucketCount);
+            bucketsSized = true;
+            std::cout << "Using " << bucketCount << "x" << bucketCount << " buckets of " << tilesPerBucket << "x" << tilesPerBucket << " tiles for a " << settings->MemoryBudget << " MiB budget." << std::endl;
+
+            // Each bucket indexes its area with its own [RegionSize] grid, so its searches stop sooner than those of an index of the whole area.
+            if (bucketCount > 1)
+            {
+                std::cout << "Warning: with more than one bucket, each bucket's search reaches less far, so tiles can differ from an in-memory export." << std::endl;
+            }
+        }
+
+        bucketsWritten = AddToBuckets(lineStrips, lineStrip);
+    });
+
+    if (!streamed)
+    {
+        std::cout << "Could not parse the input files!" << std::endl;
+        return false;
+    }
+
+    if (!bucketsWritten)
+    {
+        std::cout << "Could not write the buckets, so no tiles were rasterized!" << std::endl;
+        return false;
+    }
+
+    for (int bucket = 0; bucket < (int)bucketBuffers.size(); bucket++)
+    {
+        if (!FlushBucket(bucket))
+        {
+            return false;
+        }
+    }
+
+    std::cout << "=== Rasterizing Buckets ===" << std::endl;
+    for (int bucketY = 0; bucketY < bucketCount && bucketsSized; bucketY++)
+    {
+        for (int bucketX = 0; bucketX < bucketCount; bucketX++)
+        {
+            if (!IsBucketInRange(bucketX, bucketY))
+            {
+                continue;
+            }
+
+            if (!RasterizeBucket(bucketX, bucketY, lineStripLoader))
+            {
+                return false;
+            }
+
+            std::remove(GetBucketFileName(bucketX, bucketY).c_str());
+        }
+    }
+
+    TileWriter::RemoveFolder(bucketFolder);
+    if (settings->IsBuildingPyramid && !tilePyramid.Finish())
+    {
+        return false;
+    }
+
+    if (settings->HasTileRange && !tileManifest.Write())
+    {
+        return false;
+    }
+
+    if (!tileWriter.Finish())
+    {
+        return false;
+    }
+
+    std::cout << "Tiling and rasterization done!" << std::endl;
+    return true;
+}
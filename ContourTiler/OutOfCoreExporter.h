@@ -0,0 +1,64 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "LineStripSet.h"
+#include "LineStripLoader.h"
+#include "Settings.h"
+#include "TileManifest.h"
+#include "TilePyramid.h"
+#include "TileWriter.h"
+
+// Rasterizes every region with bounded memory by first streaming the contours into on-disk spatial buckets,
+// then loading, indexing and rasterizing a single bucket at a time.
+class OutOfCoreExporter
+{
+    Settings* settings;
+    TileWriter tileWriter;
+    TileManifest tileManifest;
+    TilePyramid tilePyramid;
+    std::string bucketFolder;
+
+    // Buckets per side, and the tiles per side within each bucket.
+    int bucketCount;
+    int tilesPerBucket;
+
+    // Tiles of surrounding contours in each bucket, covering the reach of the search.
+    int bucketHalo;
+
+    // The most square counts each grid index holds while it is built, limited by the budget.
+    size_t indexCountEntries;
+
+    // Serialized line strips waiting to be appended to each bucket file.
+    std::vector<std::vector<char>> bucketBuffers;
+    size_t flushSize;
+
+    // Picks the fewest buckets whose estimated memory use fits in the budget, warning if even single tile buckets do not.
+    void ChooseBucketCount(long pointCount);
+
+    std::string GetBucketFileName(int bucketX, int bucketY) const;
+
+    // Returns true if any tile of the bucket is within the tile range.
+    bool IsBucketInRange(int bucketX, int bucketY) const;
+
+    // Gets the normalized square covering a bucket and its halo.
+    void GetBucketArea(int bucketX, int bucketY, double* originX, double* originY, double* extent) const;
+
+    // Appends the line strip to every bucket whose area (including the halo) it overlaps, returning false if a bucket could not be written.
+    bool AddToBuckets(const LineStripSet& lineStrips, const LineStrip& lineStrip);
+    bool FlushBucket(int bucket);
+
+    // Adds the line strip of bucket-relative points, split into the parts within the fixed point range.
+    void AddQuantizedStrips(const std::vector<Point>& points, double elevation, LineStripSet& lineStrips) const;
+
+    // Loads a bucket, converting its line strips to coordinates relative to the bucket area.
+    bool LoadBucket(int bucketX, int bucketY, LineStripLoader* bucketStrips);
+
+    // Rasterizes and writes out all the tiles within a bucket, streamed by the loader.
+    bool RasterizeBucket(int bucketX, int bucketY, const LineStripLoader& lineStripLoader);
+
+public:
+    OutOfCoreExporter();
+
+    // Rasterizes and writes out all [RegionCount]x[RegionCount] regions, or those in the tile range.
+    bool Export(Settings* settings);
+};
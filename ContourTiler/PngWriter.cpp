@@ -0,0 +1,479 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+#include "PngWriter.h"
+
+// Deflate's fixed Huffman codes, with the codes bit-reversed as the bitstream is written LSB first.
+struct FixedCodes
+{
+    uint16_t literalCodes[288];
+    uint8_t literalLengths[288];
+    uint8_t distanceCodes[30];
+
+    // Length (3 to 258) to length symbol (257 to 285), and distance (1 to 32768) to distance symbol.
+    uint16_t lengthSymbols[259];
+    uint8_t distanceSymbols[32769];
+};
+
+static const int LengthBases[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const int LengthExtraBits[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const int DistanceBases[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const int DistanceExtraBits[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+static const int WindowSize = 32768;
+static const int MaxMatchLength = 258;
+static const int HashBits = 15;
+static const uint32_t AdlerBase = 65521;
+
+static uint32_t ReverseBits(uint32_t code, int length)
+{
+    uint32_t reversed = 0;
+    for (int i = 0; i < length; i++)
+    {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+
+    return reversed;
+}
+
+static FixedCodes* BuildFixedCodes()
+{
+    FixedCodes* codes = new FixedCodes();
+    for (int symbol = 0; symbol < 288; symbol++)
+    {
+        uint32_t code;
+        int length;
+        if (symbol < 144)
+        {
+            code = 0x30 + symbol;
+            length = 8;
+        }
+        else if (symbol < 256)
+        {
+            code = 0x190 + (symbol - 144);
+            length = 9;
+        }
+        else if (symbol < 280)
+        {
+            code = symbol - 256;
+            length = 7;
+        }
+        else
+        {
+            code = 0xC0 + (symbol - 280);
+            length = 8;
+        }
+
+        codes->literalCodes[symbol] = (uint16_t)ReverseBits(code, length);
+        codes->literalLengths[symbol] = (uint8_t)length;
+    }
+
+    for (int symbol = 0; symbol < 30; symbol++)
+    {
+        codes->distanceCodes[symbol] = (uint8_t)ReverseBits(symbol, 5);
+        for (int distance = DistanceBases[symbol]; distance < DistanceBases[symbol] + (1 << DistanceExtraBits[symbol]) && distance <= WindowSize; distance++)
+        {
+            codes->distanceSymbols[distance] = (uint8_t)symbol;
+        }
+    }
+
+    // 258 is also within the range of symbol 284, but has its own symbol.
+    for (int symbol = 0; symbol < 29; symbol++)
+    {
+        for (int length = LengthBases[symbol]; length < LengthBases[symbol] + (1 << LengthExtraBits[symbol]) && length <= MaxMatchLength; length++)
+        {
+            codes->lengthSymbols[length] = (uint16_t)(257 + symbol);
+        }
+    }
+
+    return codes;
+}
+
+static const FixedCodes& GetFixedCodes()
+{
+    static const FixedCodes* codes = BuildFixedCodes();
+    return *codes;
+}
+
+static uint32_t Adler32(const unsigned char* data, size_t size)
+{
+    uint32_t a = 1;
+    uint32_t b = 0;
+    while (size != 0)
+    {
+        // The most bytes before b can overflow.
+        size_t count = std::min(size, (size_t)5552);
+        size -= count;
+        while (count-- != 0)
+        {
+            a += *data++;
+            b += a;
+        }
+
+        a %= AdlerBase;
+        b %= AdlerBase;
+    }
+
+    return a | (b << 16);
+}
+
+// The Adler-32 of two pieces of data joined, from their own checksums (as zlib's adler32_combine).
+static uint32_t CombineAdler32(uint32_t first, uint32_t second, size_t secondLength)
+{
+    uint32_t remainder = (uint32_t)(secondLength % AdlerBase);
+    uint32_t a = first & 0xFFFF;
+    uint32_t b = (uint32_t)(((uint64_t)remainder * a) % AdlerBase);
+    a += (second & 0xFFFF) + AdlerBase - 1;
+    b += (first >> 16) + (second >> 16) + AdlerBase - remainder;
+    a = a >= AdlerBase ? a - AdlerBase : a;
+    a = a >= AdlerBase ? a - AdlerBase : a;
+    b = b >= 2 * AdlerBase ? b - 2 * AdlerBase : b;
+    b = b >= AdlerBase ? b - AdlerBase : b;
+    return a | (b << 16);
+}
+
+static uint32_t* BuildCrcTable()
+{
+    uint32_t* table = new uint32_t[256];
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t value = i;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            value = (value & 1) != 0 ? 0xEDB88320 ^ (value >> 1) : value >> 1;
+        }
+
+        table[i] = value;
+    }
+
+    return table;
+}
+
+static uint32_t Crc32(const unsigned char* data, size_t size)
+{
+    static const uint32_t* table = BuildCrcTable();
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+static void AppendUInt32BigEndian(std::vector<unsigned char>& data, uint32_t value)
+{
+    data.push_back((unsigned char)(value >> 24));
+    data.push_back((unsigned char)(value >> 16));
+    data.push_back((unsigned char)(value >> 8));
+    data.push_back((unsigned char)value);
+}
+
+static void AppendChunk(std::vector<unsigned char>& png, const char* type, const std::vector<unsigned char>& data)
+{
+    AppendUInt32BigEndian(png, (uint32_t)data.size());
+    size_t typeStart = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), data.begin(), data.end());
+    AppendUInt32BigEndian(png, Crc32(&png[typeStart], png.size() - typeStart));
+}
+
+// Appends bits LSB first, as deflate expects.
+struct DeflateWriter
+{
+    std::vector<unsigned char>& deflated;
+    uint64_t bits;
+    int bitCount;
+
+    DeflateWriter(std::vector<unsigned char>& deflated)
+        : deflated(deflated), bits(0), bitCount(0)
+    { }
+
+    // Writes up to 32 bits.
+    void Write(uint32_t value, int count)
+    {
+        bits |= (uint64_t)value << bitCount;
+        bitCount += count;
+        if (bitCount >= 32)
+        {
+            unsigned char word[4] = { (unsigned char)bits, (unsigned char)(bits >> 8), (unsigned char)(bits >> 16), (unsigned char)(bits >> 24) };
+            deflated.insert(deflated.end(), word, word + 4);
+            bits >>= 32;
+            bitCount -= 32;
+        }
+    }
+
+    void AlignToByte()
+    {
+        while (bitCount > 0)
+        {
+            deflated.push_back((unsigned char)bits);
+            bits >>= 8;
+            bitCount -= 8;
+        }
+
+        bits = 0;
+        bitCount = 0;
+    }
+};
+
+PngWriter::PngWriter(const unsigned char* pixels, int width, int height, int channels, int level)
+    : pixels(pixels), width(width), height(height), channels(channels), level(level)
+{ }
+
+void PngWriter::FilterRows(int firstRow, int rowCount, std::vector<unsigned char>& filtered) const
+{
+    size_t stride = (size_t)width * channels;
+    filtered.resize((stride + 1) * rowCount);
+    std::vector<unsigned char> candidates(level == 0 ? 0 : stride * 5);
+    std::vector<unsigned char> zeroRow(level == 0 ? 0 : stride, 0);
+    for (int y = firstRow; y < firstRow + rowCount; y++)
+    {
+        unsigned char* output = &filtered[(stride + 1) * (y - firstRow)];
+        const unsigned char* row = pixels + stride * y;
+        if (level == 0)
+        {
+            output[0] = 0;
+            std::copy(row, row + stride, output + 1);
+            continue;
+        }
+
+        // None, sub, up, average and Paeth, with the pixels left of and above the image as 0.
+        const unsigned char* rowAbove = y == 0 ? &zeroRow[0] : row - stride;
+        unsigned char* none = &candidates[0];
+        unsigned char* sub = &candidates[stride];
+        unsigned char* up = &candidates[stride * 2];
+        unsigned char* average = &candidates[stride * 3];
+        unsigned char* paeth = &candidates[stride * 4];
+        for (size_t i = 0; i < (size_t)channels; i++)
+        {
+            none[i] = row[i];
+            sub[i] = row[i];
+            up[i] = (unsigned char)(row[i] - rowAbove[i]);
+            average[i] = (unsigned char)(row[i] - rowAbove[i] / 2);
+            paeth[i] = (unsigned char)(row[i] - rowAbove[i]);
+        }
+
+        for (size_t i = channels; i < stride; i++)
+        {
+            int left = row[i - channels];
+            int above = rowAbove[i];
+            int aboveLeft = rowAbove[i - channels];
+            none[i] = row[i];
+            sub[i] = (unsigned char)(row[i] - left);
+            up[i] = (unsigned char)(row[i] - above);
+            average[i] = (unsigned char)(row[i] - (left + above) / 2);
+
+            int leftDistance = std::abs(above - aboveLeft);
+            int aboveDistance = std::abs(left - aboveLeft);
+            int aboveLeftDistance = std::abs(left + above - 2 * aboveLeft);
+            int prediction = leftDistance <= aboveDistance && leftDistance <= aboveLeftDistance ? left : (aboveDistance <= aboveLeftDistance ? above : aboveLeft);
+            paeth[i] = (unsigned char)(row[i] - prediction);
+        }
+
+        int bestFilter = 0;
+        int bestScore = -1;
+        for (int filter = 0; filter < 5; filter++)
+        {
+            const unsigned char* candidate = &candidates[stride * filter];
+            int score = 0;
+            for (size_t i = 0; i < stride; i++)
+            {
+                score += std::abs((int)(signed char)candidate[i]);
+            }
+
+            if (bestScore < 0 || score < bestScore)
+            {
+                bestScore = score;
+                bestFilter = filter;
+            }
+        }
+
+        output[0] = (unsigned char)bestFilter;
+        std::copy(&candidates[stride * bestFilter], &candidates[stride * bestFilter] + stride, output + 1);
+    }
+}
+
+void PngWriter::DeflateBand(Band* band, bool isLastBand) const
+{
+    std::vector<unsigned char> filtered;
+    FilterRows(band->firstRow, band->rowCount, filtered);
+    band->length = filtered.size();
+    band->adler = Adler32(&filtered[0], filtered.size());
+
+    const unsigned char* data = &filtered[0];
+    size_t size = filtered.size();
+    band->deflated.reserve(size + size / 8 + 64);
+    DeflateWriter writer(band->deflated);
+    if (level == 0)
+    {
+        // Stored blocks, each of at most 65535 bytes.
+        size_t position = 0;
+        while (position < size)
+        {
+            size_t length = std::min(size - position, (size_t)65535);
+            writer.Write(isLastBand && position + length == size ? 1 : 0, 3);
+            writer.AlignToByte();
+            writer.Write((uint32_t)length, 16);
+            writer.Write((uint32_t)(~length & 0xFFFF), 16);
+            band->deflated.insert(band->deflated.end(), data + position, data + position + length);
+            position += length;
+        }
+
+        return;
+    }
+
+    // A single block with the fixed codes, matching with hash chains that search deeper at higher levels.
+    const FixedCodes& codes = GetFixedCodes();
+    writer.Write((isLastBand ? 1 : 0) | (1 << 1), 3);
+
+    int maxChainLength = 1 << (level - 1);
+    std::vector<int32_t> heads((size_t)1 << HashBits, -1);
+    std::vector<int32_t> previous(size);
+    size_t position = 0;
+    while (position < size)
+    {
+        size_t bestLength = 0;
+        size_t bestDistance = 0;
+        if (position + 3 <= size)
+        {
+            uint32_t hash = ((data[position] | (data[position + 1] << 8) | (data[position + 2] << 16)) * 2654435761u) >> (32 - HashBits);
+            size_t maxLength = std::min(size - position, (size_t)MaxMatchLength);
+            int32_t candidate = heads[hash];
+            for (int chainLength = 0; candidate >= 0 && position - candidate <= (size_t)WindowSize && chainLength < maxChainLength; chainLength++)
+            {
+                if (data[candidate + bestLength] == data[position + bestLength])
+                {
+                    size_t length = 0;
+                    while (length < maxLength && data[candidate + length] == data[position + length])
+                    {
+                        ++length;
+                    }
+
+                    if (length > bestLength)
+                    {
+                        bestLength = length;
+                        bestDistance = position - candidate;
+                        if (length == maxLength)
+                        {
+                            break;
+                        }
+                    }
+                }
+
+                candidate = previous[candidate];
+            }
+
+            previous[position] = heads[hash];
+            heads[hash] = (int32_t)position;
+        }
+
+        if (bestLength < 3)
+        {
+            writer.Write(codes.literalCodes[data[position]], codes.literalLengths[data[position]]);
+            ++position;
+            continue;
+        }
+
+        int lengthSymbol = codes.lengthSymbols[bestLength];
+        writer.Write(codes.literalCodes[lengthSymbol], codes.literalLengths[lengthSymbol]);
+        writer.Write((uint32_t)(bestLength - LengthBases[lengthSymbol - 257]), LengthExtraBits[lengthSymbol - 257]);
+
+        int distanceSymbol = codes.distanceSymbols[bestDistance];
+        writer.Write(codes.distanceCodes[distanceSymbol], 5);
+        writer.Write((uint32_t)(bestDistance - DistanceBases[distanceSymbol]), DistanceExtraBits[distanceSymbol]);
+
+        // Later matches can start within this one.
+        for (size_t i = position + 1; i < position + bestLength && i + 3 <= size; i++)
+        {
+            uint32_t hash = ((data[i] | (data[i + 1] << 8) | (data[i + 2] << 16)) * 2654435761u) >> (32 - HashBits);
+            previous[i] = heads[hash];
+            heads[hash] = (int32_t)i;
+        }
+
+        position += bestLength;
+    }
+
+    // End of block, then an empty stored block to end the band on a byte boundary.
+    writer.Write(codes.literalCodes[256], codes.literalLengths[256]);
+    if (!isLastBand)
+    {
+        writer.Write(0, 3);
+        writer.AlignToByte();
+        writer.Write(0x0000, 16);
+        writer.Write(0xFFFF, 16);
+    }
+
+    writer.AlignToByte();
+}
+
+void PngWriter::Encode(const unsigned char* pixels, int width, int height, int channels, int level, std::vector<unsigned char>& png, int threadCount)
+{
+    PngWriter pngWriter(pixels, width, height, channels, std::max(0, std::min(level, 9)));
+
+    // Bands of whole rows, one per thread for large images.
+    size_t imageSize = ((size_t)width * channels + 1) * height;
+    size_t maxBandCount = threadCount > 0 ? (size_t)threadCount : (size_t)std::max(1u, std::thread::hardware_concurrency());
+    size_t bandCount = std::max((size_t)1, std::min(maxBandCount, imageSize / MinBandSize));
+    bandCount = std::min(bandCount, (size_t)height);
+
+    std::vector<Band> bands(bandCount);
+    for (size_t i = 0; i < bandCount; i++)
+    {
+        bands[i].firstRow = (int)(height * i / bandCount);
+        bands[i].rowCount = (int)(height * (i + 1) / bandCount) - bands[i].firstRow;
+    }
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < bandCount; i++)
+    {
+        threads.push_back(std::thread(&PngWriter::DeflateBand, &pngWriter, &bands[i], i + 1 == bandCount));
+    }
+
+    pngWriter.DeflateBand(&bands[0], bandCount == 1);
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    const unsigned char signature[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+    png.assign(signature, signature + 8);
+
+    const unsigned char colorTypes[5] = { 0, 0, 4, 2, 6 };
+    std::vector<unsigned char> header;
+    AppendUInt32BigEndian(header, (uint32_t)width);
+    AppendUInt32BigEndian(header, (uint32_t)height);
+    header.push_back(8);
+    header.push_back(colorTypes[channels]);
+    header.push_back(0);
+    header.push_back(0);
+    header.push_back(0);
+    AppendChunk(png, "IHDR", header);
+
+    // The zlib header (with a level hint, a multiple of 31 with the method byte), the joined bands and the checksum of all the rows.
+    const unsigned char levelFlags[4] = { 0x01, 0x5E, 0x9C, 0xDA };
+    std::vector<unsigned char> imageData;
+    imageData.push_back(0x78);
+    imageData.push_back(levelFlags[pngWriter.level < 2 ? 0 : (pngWriter.level < 6 ? 1 : (pngWriter.level == 6 ? 2 : 3))]);
+    uint32_t adler = 1;
+    for (const Band& band : bands)
+    {
+        imageData.insert(imageData.end(), band.deflated.begin(), band.deflated.end());
+        adler = CombineAdler32(adler, band.adler, band.length);
+    }
+
+    AppendUInt32BigEndian(imageData, adler);
+    AppendChunk(png, "IDAT", imageData);
+    AppendChunk(png, "IEND", std::vector<unsigned char>());
+}
+
+bool PngWriter::Write(const std::string& file, const unsigned char* pixels, int width, int height, int channels, int level, int threadCount)
+{
+    std::vector<unsigned char> png;
+    Encode(pixels, width, height, channels, level, png, threadCount);
+
+    std::ofstream pngFile(file, std::ios::out | std::ios::binary);
+    pngFile.write((const char*)&png[0], png.size());
+    return pngFile.good();
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Writes 8-bit PNG images, optionally deflating bands of rows on separate threads.
+// Each band is filtered and compressed on its own (matches never reach into another band), ending on a byte boundary
+// with an empty stored block as pigz does, so the bands join into a single zlib stream any decoder can read.
+class PngWriter
+{
+    struct Band
+    {
+        int firstRow;
+        int rowCount;
+        std::vector<unsigned char> deflated;
+        uint32_t adler;
+        size_t length;
+    };
+
+    const unsigned char* pixels;
+    int width;
+    int height;
+    int channels;
+    int level;
+
+    // Bands smaller than this aren't worth a thread.
+    static const size_t MinBandSize = 256 * 1024;
+
+    // Filters each row with the PNG filter giving the smallest sum of (signed) bytes, or with none when storing.
+    void FilterRows(int firstRow, int rowCount, std::vector<unsigned char>& filtered) const;
+    void DeflateBand(Band* band, bool isLastBand) const;
+
+    PngWriter(const unsigned char* pixels, int width, int height, int channels, int level);
+
+public:
+    // Encodes [Width]x[Height] pixels of 1 (grey), 2 (grey and alpha), 3 (RGB) or 4 (RGBA) channels.
+    // Level 0 stores the rows uncompressed (fastest), and 1 to 9 search progressively harder for matches.
+    // Bands are deflated on up to [threadCount] threads, or one per core if zero. Callers already running in parallel should encode serially.
+    static void Encode(const unsigned char* pixels, int width, int height, int channels, int level, std::vector<unsigned char>& png, int threadCount = 1);
+    static bool Write(const std::string& file, const unsigned char* pixels, int width, int height, int channels, int level, int threadCount = 1);
+};
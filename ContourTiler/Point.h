@@ -1,4 +1,7 @@
 #pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 
 struct Point
 {
@@ -20,4 +23,120 @@ struct LowResPoint
 
     LowResPoint(float xx, float yy) : x(xx), y(yy)
     { }
+};
+
+// Fixed-point position with 2^29 steps per normalized unit, covering -4 to 4 so that contours in the --Bounds margin fit.
+// Uses the memory of a LowResPoint with 5 more bits of precision than a float has across 0-1.
+struct QuantizedPoint
+{
+    int32_t x, y;
+
+    QuantizedPoint()
+    { }
+
+    QuantizedPoint(int32_t xx, int32_t yy) : x(xx), y(yy)
+    { }
+
+    static int32_t Quantize(double value)
+    {
+        const double stepsPerUnit = 536870912.0;
+        const double limit = 2147483647.0;
+        return (int32_t)std::max(-limit, std::min(limit, std::round(value * stepsPerUnit)));
+    }
+
+    // Returns true if the normalized position is outside of the range that can be stored without clamping.
+    static bool IsOutOfRange(double value)
+    {
+        return value <= -4.0 || value >= 4.0;
+    }
+
+    static double Dequantize(int32_t value)
+    {
+        const double unitsPerStep = 1.0 / 536870912.0;
+        return (double)value * unitsPerStep;
+    }
+};
+
+// Converts each storage format to normalized coordinates.
+inline Point ToPoint(const Point& point)
+{
+    return point;
+}
+
+inline Point ToPoint(const LowResPoint& point)
+{
+    return Point((double)point.x, (double)point.y);
+}
+
+inline Point ToPoint(const QuantizedPoint& point)
+{
+    return Point(QuantizedPoint::Dequantize(point.x), QuantizedPoint::Dequantize(point.y));
+}
+
+// Clips the segment to the square from [minimum] to [maximum] on both axes, returning false if it is entirely outside of it.
+inline bool ClipSegment(double minimum, double maximum, Point* start, Point* end)
+{
+    // Liang-Barsky, narrowing the fraction of the segment within each edge of the square in turn.
+    double startFraction = 0.0;
+    double endFraction = 1.0;
+    Point delta(end->x - start->x, end->y - start->y);
+    const double directions[4] = { -delta.x, delta.x, -delta.y, delta.y };
+    const double distances[4] = { start->x - minimum, maximum - start->x, start->y - minimum, maximum - start->y };
+    for (int i = 0; i < 4; i++)
+    {
+        if (directions[i] == 0)
+        {
+            if (distances[i] < 0)
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        double fraction = distances[i] / directions[i];
+        if (directions[i] < 0)
+        {
+            startFraction = std::max(startFraction, fraction);
+        }
+        else
+        {
+            endFraction = std::min(endFraction, fraction);
+        }
+
+        if (startFraction > endFraction)
+        {
+            return false;
+        }
+    }
+
+    // Ends within the square are left exactly as they were.
+    if (endFraction < 1.0)
+    {
+        *end = Point(start->x + delta.x * endFraction, start->y + delta.y * endFraction);
+    }
+
+    if (startFraction > 0.0)
+    {
+        *start = Point(start->x + delta.x * startFraction, start->y + delta.y * startFraction);
+    }
+
+    return true;
+}
+
+// Integral position within the quadtree grid.
+struct GridPoint
+{
+    int x, y;
+
+    GridPoint()
+    { }
+
+    GridPoint(int xx, int yy) : x(xx), y(yy)
+    { }
+
+    GridPoint operator-(const GridPoint& other) const
+    {
+        return GridPoint(x - other.x, y - other.y);
+    }
 };
\ No newline at end of file
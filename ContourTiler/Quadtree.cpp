@@ -1,6 +1,7 @@
+#include <algorithm>
 #include <sstream>
-#include <direct.h>
 #include <iostream>
+#include <utility>
 #include "Quadtree.h"
 
 Quadtree::Quadtree()
@@ -9,34 +10,125 @@ Quadtree::Quadtree()
 void Quadtree::InitializeQuadtree(int size)
 {
     this->size = size;
-    quadtree.clear();
-    for (int i = 0; i < size * size; i++)
+    quadOffsets.assign(size * size + 1, 0);
+    indexes.clear();
+}
+
+void Quadtree::SetQuads(std::vector<size_t>&& quadOffsets, std::vector<Index>&& indexes)
+{
+    this->quadOffsets = std::move(quadOffsets);
+    this->indexes = std::move(indexes);
+}
+
+void Quadtree::AppendQuads(const std::vector<size_t>& addedOffsets, const std::vector<Index>& addedIndexes)
+{
+    std::vector<size_t> mergedOffsets(quadOffsets.size(), 0);
+    std::vector<Index> mergedIndexes;
+    mergedIndexes.reserve(indexes.size() + addedIndexes.size());
+    for (size_t quad = 0; quad + 1 < quadOffsets.size(); quad++)
     {
-        quadtree.push_back(std::vector<Index>());
+        mergedOffsets[quad] = mergedIndexes.size();
+        mergedIndexes.insert(mergedIndexes.end(), indexes.begin() + quadOffsets[quad], indexes.begin() + quadOffsets[quad + 1]);
+        mergedIndexes.insert(mergedIndexes.end(), addedIndexes.begin() + addedOffsets[quad], addedIndexes.begin() + addedOffsets[quad + 1]);
     }
+
+    mergedOffsets.back() = mergedIndexes.size();
+    SetQuads(std::move(mergedOffsets), std::move(mergedIndexes));
+}
+
+size_t Quadtree::ElementsInQuad(GridPoint quadtreePos) const
+{
+    int quad = quadtreePos.x + size * quadtreePos.y;
+    return quadOffsets[quad + 1] - quadOffsets[quad];
+}
+
+Index Quadtree::GetIndexFromQuad(GridPoint quadtreePos, int offset) const
+{
+    return indexes[quadOffsets[quadtreePos.x + size * quadtreePos.y] + offset];
 }
 
-void Quadtree::AddToIndex(sf::Vector2i quadtreePos, Index index)
+void Quadtree::ComputeOccupancy()
 {
-    if (quadtreePos.x < 0 || quadtreePos.y < 0)
+    int stride = size + 1;
+    occupiedQuadSums.assign(stride * stride, 0);
+    for (int y = 0; y < size; y++)
     {
-        return;
+        for (int x = 0; x < size; x++)
+        {
+            int isOccupied = ElementsInQuad(GridPoint(x, y)) == 0 ? 0 : 1;
+            occupiedQuadSums[(x + 1) + stride * (y + 1)] = isOccupied +
+                occupiedQuadSums[x + stride * (y + 1)] + occupiedQuadSums[(x + 1) + stride * y] - occupiedQuadSums[x + stride * y];
+        }
     }
 
-    if (quadtreePos.x >= size || quadtreePos.y >= size)
+    // Two-pass chamfer transform. With unit weights on all 8 neighbors this is the exact chessboard distance.
+    const int farDistance = 2 * size + 1;
+    occupiedQuadDistances.assign(size * size, farDistance);
+    for (int y = 0; y < size; y++)
     {
-        return;
+        for (int x = 0; x < size; x++)
+        {
+            int& distance = occupiedQuadDistances[x + size * y];
+            if (ElementsInQuad(GridPoint(x, y)) != 0)
+            {
+                distance = 0;
+                continue;
+            }
+
+            for (int j = -1; j <= 0; j++)
+            {
+                for (int i = -1; i <= 1 && (j < 0 || i < 0); i++)
+                {
+                    if (x + i >= 0 && x + i < size && y + j >= 0)
+                    {
+                        distance = std::min(distance, occupiedQuadDistances[(x + i) + size * (y + j)] + 1);
+                    }
+                }
+            }
+        }
     }
 
-    quadtree[quadtreePos.x + size * quadtreePos.y].push_back(index);
+    for (int y = size - 1; y >= 0; y--)
+    {
+        for (int x = size - 1; x >= 0; x--)
+        {
+            int& distance = occupiedQuadDistances[x + size * y];
+            for (int j = 0; j <= 1; j++)
+            {
+                for (int i = -1; i <= 1; i++)
+                {
+                    if ((j > 0 || i > 0) && x + i >= 0 && x + i < size && y + j < size)
+                    {
+                        distance = std::min(distance, occupiedQuadDistances[(x + i) + size * (y + j)] + 1);
+                    }
+                }
+            }
+        }
+    }
 }
 
-size_t Quadtree::ElementsInQuad(sf::Vector2i quadtreePos) const
+int Quadtree::DistanceToOccupiedQuad(GridPoint quadtreePos) const
 {
-    return quadtree[quadtreePos.x + size * quadtreePos.y].size();
+    return occupiedQuadDistances[quadtreePos.x + size * quadtreePos.y];
 }
 
-Index Quadtree::GetIndexFromQuad(sf::Vector2i quadtreePos, int offset) const
+int Quadtree::OccupiedQuadsWithin(GridPoint center, int radius) const
 {
-    return quadtree[quadtreePos.x + size * quadtreePos.y][offset];
+    if (radius < 0)
+    {
+        return 0;
+    }
+
+    int minX = std::max(center.x - radius, 0);
+    int minY = std::max(center.y - radius, 0);
+    int maxX = std::min(center.x + radius + 1, size);
+    int maxY = std::min(center.y + radius + 1, size);
+    if (minX >= maxX || minY >= maxY)
+    {
+        return 0;
+    }
+
+    int stride = size + 1;
+    return occupiedQuadSums[maxX + stride * maxY] - occupiedQuadSums[minX + stride * maxY] -
+        occupiedQuadSums[maxX + stride * minY] + occupiedQuadSums[minX + stride * minY];
 }
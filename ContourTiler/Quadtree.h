@@ -3,20 +3,43 @@
 #include <string>
 #include <vector>
 #include <queue>
-#include <SFML\System.hpp>
 #include "Index.h"
+#include "Point.h"
 
 class Quadtree
 {
     int size;
-    std::vector<std::vector<Index>> quadtree;
+
+    // Quad q holds indexes[quadOffsets[q]] up to indexes[quadOffsets[q + 1]], with quads in row-major order.
+    std::vector<size_t> quadOffsets;
+    std::vector<Index> indexes;
+
+    // Summed-area table of the non-empty quads, with a leading row and column of zeros.
+    std::vector<int> occupiedQuadSums;
+
+    // Chessboard distance (in quads) from each quad to the nearest non-empty quad. Zero for non-empty quads.
+    std::vector<int> occupiedQuadDistances;
 
 public:
     Quadtree();
 
     void InitializeQuadtree(int size);
-    void AddToIndex(sf::Vector2i quadtreePos, Index index);
-    size_t ElementsInQuad(sf::Vector2i quadtreePos) const;
-    Index GetIndexFromQuad(sf::Vector2i quadtreePos, int offset) const;
+
+    // Replaces the contents of all quads, taking the offsets of each quad (plus the end) and the indexes of all quads.
+    void SetQuads(std::vector<size_t>&& quadOffsets, std::vector<Index>&& indexes);
+
+    // Adds indexes to the end of each quad, taking the offsets of each quad (plus the end) and the indexes to add.
+    void AppendQuads(const std::vector<size_t>& addedOffsets, const std::vector<Index>& addedIndexes);
+    size_t ElementsInQuad(GridPoint quadtreePos) const;
+    Index GetIndexFromQuad(GridPoint quadtreePos, int offset) const;
+
+    // Counts the non-empty quads and their distances, once all indexes have been added.
+    void ComputeOccupancy();
+
+    // Returns the chessboard distance from the quad to the nearest non-empty quad, or more than the size if all are empty.
+    int DistanceToOccupiedQuad(GridPoint quadtreePos) const;
+
+    // Returns the number of non-empty quads within [radius] quads of the center (clipped to the grid), or 0 for a negative radius.
+    int OccupiedQuadsWithin(GridPoint center, int radius) const;
 };
 
@@ -0,0 +1,285 @@
+#define _USE_MATH_DEFINES
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <queue>
+#include <utility>
+#include "GridIndex.h"
+#include "RTreeIndex.h"
+
+const uint32_t RTreeIndex::Node::LeafFlag;
+
+RTreeIndex::RTreeIndex(int size)
+    : maxDistance((double)GridIndex::MaxRings / (double)size), lineStrips(nullptr), segments(), nodes(), root(0), searchLines(&RTreeIndex::SearchLines<Point>)
+{ }
+
+float RTreeIndex::RoundDown(double value)
+{
+    float rounded = (float)value;
+    return (double)rounded > value ? std::nextafter(rounded, -std::numeric_limits<float>::infinity()) : rounded;
+}
+
+float RTreeIndex::RoundUp(double value)
+{
+    float rounded = (float)value;
+    return (double)rounded < value ? std::nextafter(rounded, std::numeric_limits<float>::infinity()) : rounded;
+}
+
+double RTreeIndex::GetDistanceSqd(Point point, float minX, float minY, float maxX, float maxY)
+{
+    double xDistance = std::max(std::max((double)minX - point.x, point.x - (double)maxX), 0.0);
+    double yDistance = std::max(std::max((double)minY - point.y, point.y - (double)maxY), 0.0);
+    return xDistance * xDistance + yDistance * yDistance;
+}
+
+std::vector<RTreeIndex::Bounds> RTreeIndex::PackLevel(const std::vector<Bounds>& itemBounds, std::vector<uint32_t>& items, bool isLeaf)
+{
+    // Sort-tile-recursive: sort by x into vertical slices, then each slice by y, and group runs of [Fanout] items.
+    // Stable sorts keep the tree the same from run to run.
+    size_t nodeCount = (items.size() + Fanout - 1) / Fanout;
+    size_t sliceCount = (size_t)std::ceil(std::sqrt((double)nodeCount));
+    size_t sliceSize = sliceCount * Fanout;
+
+    std::vector<size_t> order(items.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&itemBounds](size_t a, size_t b)
+    {
+        return itemBounds[a].minX + itemBounds[a].maxX < itemBounds[b].minX + itemBounds[b].maxX;
+    });
+
+    for (size_t sliceStart = 0; sliceStart < order.size(); sliceStart += sliceSize)
+    {
+        size_t sliceEnd = std::min(sliceStart + sliceSize, order.size());
+        std::stable_sort(order.begin() + sliceStart, order.begin() + sliceEnd, [&itemBounds](size_t a, size_t b)
+        {
+            return itemBounds[a].minY + itemBounds[a].maxY < itemBounds[b].minY + itemBounds[b].maxY;
+        });
+    }
+
+    std::vector<Bounds> nodeBounds;
+    std::vector<uint32_t> nodeItems;
+    for (size_t start = 0; start < order.size(); start += Fanout)
+    {
+        Node node;
+        int childCount = (int)std::min((size_t)Fanout, order.size() - start);
+        node.header = (uint32_t)childCount | (isLeaf ? Node::LeafFlag : 0u);
+
+        Bounds bounds = itemBounds[order[start]];
+        for (int i = 0; i < childCount; i++)
+        {
+            const Bounds& childBounds = itemBounds[order[start + i]];
+            node.minX[i] = childBounds.minX;
+            node.minY[i] = childBounds.minY;
+            node.maxX[i] = childBounds.maxX;
+            node.maxY[i] = childBounds.maxY;
+            node.children[i] = items[order[start + i]];
+
+            bounds.minX = std::min(bounds.minX, childBounds.minX);
+            bounds.minY = std::min(bounds.minY, childBounds.minY);
+            bounds.maxX = std::max(bounds.maxX, childBounds.maxX);
+            bounds.maxY = std::max(bounds.maxY, childBounds.maxY);
+        }
+
+        nodeItems.push_back((uint32_t)nodes.size());
+        nodeBounds.push_back(bounds);
+        nodes.push_back(node);
+    }
+
+    items.swap(nodeItems);
+    return nodeBounds;
+}
+
+void RTreeIndex::Build(const LineStripSet* lineStrips)
+{
+    this->lineStrips = lineStrips;
+    segments.clear();
+    nodes.clear();
+
+    switch (lineStrips->GetPointType())
+    {
+    case LineStripSet::PointType::Quantized:
+        searchLines = &RTreeIndex::SearchLines<QuantizedPoint>;
+        break;
+    case LineStripSet::PointType::LowRes:
+        searchLines = &RTreeIndex::SearchLines<LowResPoint>;
+        break;
+    default:
+        searchLines = &RTreeIndex::SearchLines<Point>;
+        break;
+    }
+
+    std::cout << "  Populating with " << lineStrips->strips.size() << " line strips..." << std::endl;
+    std::vector<Bounds> itemBounds;
+    std::vector<uint32_t> items;
+    for (size_t i = 0; i < lineStrips->strips.size(); i++)
+    {
+        for (uint32_t j = 0; j + 1 < lineStrips->strips[i].count; j++)
+        {
+            Point start, end;
+            Index index((int)i, (int)j);
+            lineStrips->GetSegment(index, &start, &end);
+
+            Bounds bounds;
+            bounds.minX = RoundDown(std::min(start.x, end.x));
+            bounds.minY = RoundDown(std::min(start.y, end.y));
+            bounds.maxX = RoundUp(std::max(start.x, end.x));
+            bounds.maxY = RoundUp(std::max(start.y, end.y));
+
+            items.push_back((uint32_t)segments.size());
+            itemBounds.push_back(bounds);
+            segments.push_back(index);
+        }
+    }
+
+    if (segments.empty())
+    {
+        return;
+    }
+
+    bool isLeaf = true;
+    do
+    {
+        itemBounds = PackLevel(itemBounds, items, isLeaf);
+        isLeaf = false;
+    }
+    while (items.size() > 1);
+
+    root = items[0];
+    std::cout << "  Indexed " << segments.size() << " segments in " << nodes.size() << " nodes." << std::endl;
+}
+
+bool RTreeIndex::CanImprove(Point point, const ElevationComputer& elevationComputer, float minX, float minY, float maxX, float maxY, double distanceSqd) const
+{
+    if (point.x >= (double)minX && point.x <= (double)maxX && point.y >= (double)minY && point.y <= (double)maxY)
+    {
+        return elevationComputer.CanImprove(distanceSqd);
+    }
+
+    // The point is outside of the bounds, so the corners span less than half a turn around the center direction.
+    double centerAngle = std::atan2(0.5 * ((double)minY + (double)maxY) - point.y, 0.5 * ((double)minX + (double)maxX) - point.x);
+    double minOffset = 0.0;
+    double maxOffset = 0.0;
+    const double cornerXs[2] = { (double)minX, (double)maxX };
+    const double cornerYs[2] = { (double)minY, (double)maxY };
+    for (int i = 0; i < 4; i++)
+    {
+        double offset = std::atan2(cornerYs[i / 2] - point.y, cornerXs[i % 2] - point.x) - centerAngle;
+        if (offset > M_PI)
+        {
+            offset -= 2 * M_PI;
+        }
+        else if (offset <= -M_PI)
+        {
+            offset += 2 * M_PI;
+        }
+
+        minOffset = std::min(minOffset, offset);
+        maxOffset = std::max(maxOffset, offset);
+    }
+
+    // Widened slightly so rounding never excludes a sector the lines within could land in.
+    const double angleEpsilon = 1e-9;
+    return elevationComputer.CanImprove(centerAngle + minOffset - angleEpsilon, centerAngle + maxOffset + angleEpsilon, distanceSqd);
+}
+
+void RTreeIndex::Search(Point point, ElevationComputer& elevationComputer, RasterCost* cost) const
+{
+    (this->*searchLines)(point, elevationComputer, cost);
+}
+
+template <typename T>
+void RTreeIndex::SearchLines(Point point, ElevationComputer& elevationComputer, RasterCost* cost) const
+{
+    if (segments.empty())
+    {
+        return;
+    }
+
+    // Best-first search, visiting nodes in order of their distance from the point.
+    const double maxDistanceSqd = maxDistance * maxDistance;
+    typedef std::pair<double, uint32_t> QueuedNode;
+    std::priority_queue<QueuedNode, std::vector<QueuedNode>, std::greater<QueuedNode>> queue;
+    queue.push(QueuedNode(0.0, root));
+    while (!queue.empty())
+    {
+        QueuedNode queuedNode = queue.top();
+        queue.pop();
+
+        // Every remaining node is at least this far away.
+        if (queuedNode.first > maxDistanceSqd || !elevationComputer.CanImprove(queuedNode.first))
+        {
+            return;
+        }
+
+        const Node& node = nodes[queuedNode.second];
+        if (cost != nullptr)
+        {
+            ++cost->ringsVisited;
+        }
+
+        for (int i = 0; i < node.ChildCount(); i++)
+        {
+            double distanceSqd = GetDistanceSqd(point, node.minX[i], node.minY[i], node.maxX[i], node.maxY[i]);
+            if (distanceSqd > maxDistanceSqd ||
+                !CanImprove(point, elevationComputer, node.minX[i], node.minY[i], node.maxX[i], node.maxY[i], distanceSqd))
+            {
+                continue;
+            }
+
+            if (node.IsLeaf())
+            {
+                const Index& index = segments[node.children[i]];
+                T start, end;
+                lineStrips->GetStoredSegment(index, &start, &end);
+                elevationComputer.ProcessLine(start, end, lineStrips->strips[index.stripIdx].elevation);
+                if (cost != nullptr)
+                {
+                    ++cost->segmentsTested;
+                }
+            }
+            else
+            {
+                queue.push(QueuedNode(distanceSqd, node.children[i]));
+            }
+        }
+    }
+}
+
+void RTreeIndex::FindSegmentsNear(Point point, double distance, std::vector<Index>& segments) const
+{
+    if (this->segments.empty())
+    {
+        return;
+    }
+
+    const double distanceSqd = distance * distance;
+    std::vector<uint32_t> nodesToSearch;
+    nodesToSearch.push_back(root);
+    while (!nodesToSearch.empty())
+    {
+        const Node& node = nodes[nodesToSearch.back()];
+        nodesToSearch.pop_back();
+        for (int i = 0; i < node.ChildCount(); i++)
+        {
+            if (GetDistanceSqd(point, node.minX[i], node.minY[i], node.maxX[i], node.maxY[i]) > distanceSqd)
+            {
+                continue;
+            }
+
+            if (node.IsLeaf())
+            {
+                segments.push_back(this->segments[node.children[i]]);
+            }
+            else
+            {
+                nodesToSearch.push_back(node.children[i]);
+            }
+        }
+    }
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+#include "SegmentIndex.h"
+
+// Allocates storage aligned to the type, which std::allocator only guarantees beyond 16 bytes from C++17.
+template <typename T>
+struct AlignedAllocator
+{
+    typedef T value_type;
+
+    AlignedAllocator()
+    { }
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U>&)
+    { }
+
+    T* allocate(std::size_t count)
+    {
+        // Over-allocate to align the start, storing the allocation just before it to free later.
+        char* allocation = static_cast<char*>(::operator new(count * sizeof(T) + alignof(T) + sizeof(void*)));
+        std::uintptr_t start = (reinterpret_cast<std::uintptr_t>(allocation) + sizeof(void*) + alignof(T) - 1) & ~(std::uintptr_t)(alignof(T) - 1);
+        reinterpret_cast<void**>(start)[-1] = allocation;
+        return reinterpret_cast<T*>(start);
+    }
+
+    void deallocate(T* pointer, std::size_t)
+    {
+        ::operator delete(reinterpret_cast<void**>(pointer)[-1]);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const AlignedAllocator<T>&, const AlignedAllocator<U>&)
+{
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const AlignedAllocator<T>&, const AlignedAllocator<U>&)
+{
+    return false;
+}
+
+// Indexes segments in a bulk-loaded (sort-tile-recursive) R-tree, searching nodes outwards from each point in order of distance.
+// Unlike the grid, each sector ends with its nearest line, and subtrees are skipped once they cannot change any sector they face.
+class RTreeIndex : public SegmentIndex
+{
+    static const int Fanout = 8;
+    static const int CacheLineSize = 64;
+
+    // Child bounds are stored per axis so a node's children are tested together. Bounds are rounded outwards to floats.
+    // Nodes start on a cache line and fill exactly three, so visiting one never touches a line of another.
+    struct alignas(CacheLineSize) Node
+    {
+        static const uint32_t LeafFlag = 0x80000000u;
+
+        // The child count, with LeafFlag set for leaves.
+        uint32_t header;
+
+        float minX[Fanout];
+        float minY[Fanout];
+        float maxX[Fanout];
+        float maxY[Fanout];
+
+        // Nodes for interior nodes, or segments for leaves.
+        uint32_t children[Fanout];
+
+        int ChildCount() const
+        {
+            return (int)(header & ~LeafFlag);
+        }
+
+        bool IsLeaf() const
+        {
+            return (header & LeafFlag) != 0;
+        }
+    };
+
+    static_assert(sizeof(Node) == 3 * CacheLineSize, "R-tree nodes should fill whole cache lines.");
+
+    struct Bounds
+    {
+        float minX, minY, maxX, maxY;
+    };
+
+    // Searches stop at the distance the grid index reaches with the same region size.
+    double maxDistance;
+    const LineStripSet* lineStrips;
+
+    std::vector<Index> segments;
+    std::vector<Node, AlignedAllocator<Node>> nodes;
+    uint32_t root;
+
+    static float RoundDown(double value);
+    static float RoundUp(double value);
+
+    // Returns the squared distance from the point to the bounds, zero if within them.
+    static double GetDistanceSqd(Point point, float minX, float minY, float maxX, float maxY);
+
+    // Groups the items into nodes of up to [Fanout] children, returning the bounds of each new node.
+    std::vector<Bounds> PackLevel(const std::vector<Bounds>& itemBounds, std::vector<uint32_t>& items, bool isLeaf);
+
+    // Returns true if a line within the bounds could change a sector of the computer.
+    bool CanImprove(Point point, const ElevationComputer& elevationComputer, float minX, float minY, float maxX, float maxY, double distanceSqd) const;
+
+    // Searches reading the segments as stored in the arena of type T, chosen by Build for the lines indexed.
+    template <typename T>
+    void SearchLines(Point point, ElevationComputer& elevationComputer, RasterCost* cost) const;
+
+    typedef void (RTreeIndex::*SearchFunction)(Point point, ElevationComputer& elevationComputer, RasterCost* cost) const;
+    SearchFunction searchLines;
+
+public:
+    RTreeIndex(int size);
+
+    virtual void Build(const LineStripSet* lineStrips) override;
+    virtual void Search(Point point, ElevationComputer& elevationComputer, RasterCost* cost) const override;
+    virtual void FindSegmentsNear(Point point, double distance, std::vector<Index>& segments) const override;
+};
@@ -0,0 +1,13 @@
+#pragma once
+
+// Search cost of computing the elevation of a single pixel, for diagnosing slow regions.
+struct RasterCost
+{
+    // Rings of the grid index, or nodes of the R-tree index.
+    int ringsVisited;
+    int segmentsTested;
+    int sectorsFilled;
+
+    RasterCost() : ringsVisited(0), segmentsTested(0), sectorsFilled(0)
+    { }
+};
@@ -1,173 +1,442 @@
+#include <algorithm>
 #include <cmath>
 #include <thread>
 #include <iostream>
 #include <limits>
 #include <map>
 #include <mutex>
-#include <immintrin.h>
-#include <xmmintrin.h>
 #include "ElevationComputer.h"
+#include "GridIndex.h"
+#include "LineSimplifier.h"
 #include "Rasterizer.h"
+#include "RTreeIndex.h"
 
 std::mutex logMutex;
 
+const int Rasterizer::AdaptiveLatticeSize;
+
 Rasterizer::Rasterizer(LineStripLoader* lineStripLoader)
-    : lineStrips(lineStripLoader), quadtree()
+    : lineStrips(lineStripLoader), levels(), maxIndexCountEntries(GridIndex::DefaultMaxCountEntries), contourElevations(), maxError(0.0), exactPixelCount(0), totalExactPixelCount(0), totalPixelCount(0), rasterizeLineColumnRange(&Rasterizer::RasterizeLineColumnRange<Point>)
 {
 }
 
+void Rasterizer::IndexLevel(GeometryLevel& level)
+{
+    if (this->settings->IsRTreeIndex)
+    {
+        level.index.reset(new RTreeIndex(this->size));
+    }
+    else
+    {
+        level.index.reset(new GridIndex(this->size, maxIndexCountEntries));
+    }
+
+    level.index->Build(level.lineStrips);
+}
+
+void Rasterizer::SetMaxIndexCountEntries(size_t maxCountEntries)
+{
+    maxIndexCountEntries = maxCountEntries;
+}
+
 void Rasterizer::Setup(Settings* settings)
 {
     this->settings = settings;
     this->size = this->settings->RegionSize;
 
-    std::cout << "Initializing point lookup quadtree..." << std::endl;
-    quadtree.InitializeQuadtree(this->size);
+    std::cout << "Initializing point lookup index..." << std::endl;
+    levels.clear();
+    nodeLevels.clear();
+    levels.push_back(std::unique_ptr<GeometryLevel>(new GeometryLevel()));
+    levels[0]->lineStrips = &lineStrips->lineStrips;
+    IndexLevel(*levels[0]);
+
+    // The coarsest level is within half a pixel at the full-extent overview, and each finer level is 4x more precise.
+    for (int i = 1; i < this->settings->LodLevels; i++)
+    {
+        double tolerance = (0.5 / (double)this->size) / std::pow(4.0, (double)(this->settings->LodLevels - 1 - i));
+
+        std::cout << "Initializing level of detail " << i << " with a tolerance of " << tolerance * (double)this->size << " overview pixels..." << std::endl;
+        GeometryLevel* level = new GeometryLevel();
+        levels.push_back(std::unique_ptr<GeometryLevel>(level));
+        level->tolerance = tolerance;
+        level->simplifiedLineStrips = *levels[i - 1]->lineStrips;
+        level->lineStrips = &level->simplifiedLineStrips;
+
+        // Simplifying the previous level adds to its error. 3/4 of the tolerance keeps the geometric series of errors within the tolerance.
+        LineSimplifier(tolerance * 0.75, 1.0, 1.0).SimplifyAll(level->simplifiedLineStrips);
+        std::cout << "  Segments: " << LineSimplifier::CountSegments(level->simplifiedLineStrips) << std::endl;
+        IndexLevel(*level);
+    }
+
+    if (this->settings->IsNumaAware)
+    {
+        ReplicateLevels();
+    }
 
-    // Now fill in all the quadtree files with the indexes of all the lines within the area.
-    std::cout << "  Populating with " << lineStrips->lineStrips.size() << " line strips..." << std::endl;
-    for (int i = 0; i < lineStrips->lineStrips.size(); i++)
+    switch (lineStrips->lineStrips.GetPointType())
     {
-        if (this->settings->IsHighResolution)
+    case LineStripSet::PointType::Quantized:
+        rasterizeLineColumnRange = &Rasterizer::RasterizeLineColumnRange<QuantizedPoint>;
+        break;
+    case LineStripSet::PointType::LowRes:
+        rasterizeLineColumnRange = &Rasterizer::RasterizeLineColumnRange<LowResPoint>;
+        break;
+    default:
+        rasterizeLineColumnRange = &Rasterizer::RasterizeLineColumnRange<Point>;
+        break;
+    }
+
+    // Adaptive sampling treats the surface between two contours as smooth, so needs the contour elevations.
+    if (this->settings->MaxError > 0)
+    {
+        contourElevations.clear();
+        for (const LineStrip& lineStrip : lineStrips->lineStrips.strips)
         {
-            AddPointsToQuadtree(i, lineStrips->lineStrips[i].points);
+            contourElevations.push_back(lineStrip.elevation);
         }
-        else
+
+        std::sort(contourElevations.begin(), contourElevations.end());
+        contourElevations.erase(std::unique(contourElevations.begin(), contourElevations.end()), contourElevations.end());
+
+        double elevationRange = lineStrips->ElevationRange();
+        maxError = elevationRange > 0 ? this->settings->MaxError / elevationRange : this->settings->MaxError;
+    }
+
+    std::cout << "Index initialized!" << std::endl;
+}
+
+void Rasterizer::ReplicateLevels()
+{
+    NumaTopology topology;
+    if (topology.NodeCount() == 1)
+    {
+        std::cout << "Only one NUMA node was found, so the index is not replicated." << std::endl;
+        return;
+    }
+
+    // Memory is allocated on the node of the thread that first writes to it, so each copy is made by a thread pinned to its node.
+    nodeLevels.resize(topology.NodeCount());
+    for (int node = 0; node < topology.NodeCount(); node++)
+    {
+        std::cout << "Replicating the index onto NUMA node " << node << " of " << topology.NodeCount() << "..." << std::endl;
+        std::thread replicator([this, &topology, node]()
         {
-            AddPointsToQuadtree(i, lineStrips->lineStrips[i].lowResPoints);
-        }
+            topology.PinThread(node);
+            for (size_t i = 0; i < levels.size(); i++)
+            {
+                GeometryLevel* level = new GeometryLevel();
+                nodeLevels[node].push_back(std::unique_ptr<GeometryLevel>(level));
+                level->tolerance = levels[i]->tolerance;
+                level->simplifiedLineStrips = *levels[i]->lineStrips;
+                level->lineStrips = &level->simplifiedLineStrips;
+                IndexLevel(*level);
+            }
+        });
+
+        replicator.join();
+    }
+}
+
+const GeometryLevel& Rasterizer::GetLevel(double effectiveSize) const
+{
+    int node = NumaTopology::CurrentNode();
+    const std::vector<std::unique_ptr<GeometryLevel>>& localLevels = (node >= 0 && node < (int)nodeLevels.size()) ? nodeLevels[node] : levels;
 
-        if (lineStrips->lineStrips.size() / 10 != 0 && (i % (lineStrips->lineStrips.size() / 10)) == 0)
+    double halfPixelSize = 0.5 * effectiveSize / (double)size;
+    for (size_t i = localLevels.size() - 1; i > 0; i--)
+    {
+        if (localLevels[i]->tolerance <= halfPixelSize)
         {
-            std::cout << "  Processed line strip " << i << " of " << lineStrips->lineStrips.size() << std::endl;
+            return *localLevels[i];
         }
     }
 
-    std::cout << "Quadtree initialized!" << std::endl;
+    return *localLevels[0];
 }
 
 // Same as the above but treats the index as a line.
-double Rasterizer::GetLineDistanceSqd(Index idx, Point point)
+template <typename T>
+double Rasterizer::GetLineDistanceSqd(const GeometryLevel& level, Index idx, Point point)
 {
+    T start, end;
+    level.lineStrips->GetStoredSegment(idx, &start, &end);
+
     Point closestPoint = Point();
-    if (this->settings->IsHighResolution)
+    ElevationComputer::GetClosestPointOnLine(point, ToPoint(start), ToPoint(end), &closestPoint);
+    return pow(point.x - closestPoint.x, 2) + pow(point.y - closestPoint.y, 2);
+}
+
+double Rasterizer::ComputeElevation(const GeometryLevel& level, Point point, RasterCost* cost, double* nearestDistanceSqd)
+{
+    ElevationComputer elevationComputer = ElevationComputer(point);
+    level.index->Search(point, elevationComputer, cost);
+
+    if (cost != nullptr)
     {
-        Point& start = lineStrips->lineStrips[idx.stripIdx].points[idx.pointIdx];
-        Point& end = lineStrips->lineStrips[idx.stripIdx].points[idx.pointIdx + 1];
-        ElevationComputer::GetClosestPointOnLine(point, start, end, &closestPoint);
+        cost->sectorsFilled = elevationComputer.PopulatedRegionCount();
     }
-    else
+
+    if (nearestDistanceSqd != nullptr)
     {
-        LowResPoint& start = lineStrips->lineStrips[idx.stripIdx].lowResPoints[idx.pointIdx];
-        LowResPoint& end = lineStrips->lineStrips[idx.stripIdx].lowResPoints[idx.pointIdx + 1];
-        ElevationComputer::GetClosestPointOnLine(point, Point(start.x, start.y), Point(end.x, end.y), &closestPoint);
+        *nearestDistanceSqd = elevationComputer.GetNearestDistanceSqd();
     }
 
-    return pow(point.x - closestPoint.x, 2) + pow(point.y - closestPoint.y, 2);
+    return elevationComputer.GetWeightedElevation();
+}
+
+void Rasterizer::ComputeColumn(double leftOffset, double topOffset, double effectiveSize, int column, double* rasterStore, RasterCost* costStore)
+{
+    const GeometryLevel& level = GetLevel(effectiveSize);
+    if (settings->MaxError > 0)
+    {
+        if (column % AdaptiveLatticeSize == 0)
+        {
+            ComputeAdaptiveBand(level, leftOffset, topOffset, effectiveSize, column, rasterStore, costStore);
+        }
+
+        return;
+    }
+
+    for (int j = 0; j < size; j++)
+    {
+        double x = leftOffset + ((double)column / (double)size) * effectiveSize;
+        double y = topOffset + ((double)j / (double)size) * effectiveSize;
+
+        Point point(x, y);
+        RasterCost* cost = nullptr;
+        if (costStore != nullptr)
+        {
+            cost = &costStore[column + j * size];
+            *cost = RasterCost();
+        }
+
+        double elevation = ComputeElevation(level, point, cost);
+        rasterStore[column + j * size] = elevation;
+    }
 }
 
-void Rasterizer::AddIfValid(int xP, int yP, std::vector<sf::Vector2i>& searchQuads)
+double Rasterizer::GetExactSample(AdaptiveBand& band, int x, int y)
 {
-    sf::Vector2i pt(xP, yP);
-    if (xP >= 0 && yP >= 0 && xP < size && yP < size && quadtree.ElementsInQuad(pt) != 0)
+    size_t index = (size_t)x + (size_t)y * (band.width + 1);
+    if (band.isExact[index])
     {
-        searchQuads.push_back(sf::Vector2i(xP, yP));
+        return band.samples[index];
     }
+
+    // The same point as ComputeColumn, so exact samples match the full rasterization.
+    int column = band.startColumn + x;
+    Point point(band.leftOffset + ((double)column / (double)size) * band.effectiveSize, band.topOffset + ((double)y / (double)size) * band.effectiveSize);
+
+    // The lattice column after the band belongs to the next band.
+    bool isInBand = x < AdaptiveLatticeSize;
+    RasterCost* cost = isInBand && band.costStore != nullptr ? &band.costStore[column + y * size] : nullptr;
+    double nearestDistanceSqd;
+    band.samples[index] = ComputeElevation(*band.level, point, cost, &nearestDistanceSqd);
+    band.contourDistances[index] = (float)(std::sqrt(nearestDistanceSqd) * (double)size / band.effectiveSize);
+    band.isExact[index] = true;
+    band.exactPixelCount += isInBand ? 1 : 0;
+    return band.samples[index];
 }
 
-void Rasterizer::AddAreasToSearch(int distance, sf::Vector2i startQuad, std::vector<sf::Vector2i>& searchQuads)
+bool Rasterizer::IsQuadSmooth(AdaptiveBand& band, int x0, int y0, int x1, int y1)
 {
-    if (distance == 1)
+    double corners[4] = { GetExactSample(band, x0, y0), GetExactSample(band, x1, y0), GetExactSample(band, x0, y1), GetExactSample(band, x1, y1) };
+    double lowest = *std::min_element(corners, corners + 4);
+    double highest = *std::max_element(corners, corners + 4);
+
+    // A contour between the corners, or a contour near enough to a corner to cross the quad, puts a crease in the surface.
+    auto contourAbove = std::lower_bound(contourElevations.begin(), contourElevations.end(), lowest);
+    if (lowest < highest && contourAbove != contourElevations.end() && *contourAbove <= highest)
     {
-        searchQuads.push_back(startQuad);
+        return false;
     }
 
-    // Add the horizontal bars
-    for (int i = startQuad.x - distance; i <= startQuad.x + distance; i++)
+    double diagonal = std::sqrt((double)((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0)));
+    size_t rowSize = band.width + 1;
+    if (band.contourDistances[x0 + y0 * rowSize] < diagonal || band.contourDistances[x1 + y0 * rowSize] < diagonal ||
+        band.contourDistances[x0 + y1 * rowSize] < diagonal || band.contourDistances[x1 + y1 * rowSize] < diagonal)
     {
-        AddIfValid(i, startQuad.y + distance, searchQuads);
-        AddIfValid(i, startQuad.y - distance, searchQuads);
+        return false;
     }
 
-    // Add the vertical bars, skipping the corners that otherwise would be duplicated.
-    for (int j = startQuad.y - (distance - 1); j <= startQuad.y + (distance - 1); j++)
+    // Otherwise the surface is smooth if the center and edge midpoints are close to interpolated. Nearby contours can pull the surface
+    // outside of the contours either side of the corners, so it isn't bounded by them. The deviation between the samples grows
+    // with the square of their spacing, so half the maximum error at the samples keeps the pixels between them within it.
+    int centerX = (x0 + x1) / 2;
+    int centerY = (y0 + y1) / 2;
+    const int checkPoints[5][2] = { { centerX, centerY }, { centerX, y0 }, { centerX, y1 }, { x0, centerY }, { x1, centerY } };
+    for (const int* checkPoint : checkPoints)
     {
-        AddIfValid(startQuad.x + distance, j, searchQuads);
-        AddIfValid(startQuad.x - distance, j, searchQuads);
+        double fractionX = x1 == x0 ? 0.0 : (double)(checkPoint[0] - x0) / (double)(x1 - x0);
+        double fractionY = y1 == y0 ? 0.0 : (double)(checkPoint[1] - y0) / (double)(y1 - y0);
+        double interpolated = (corners[0] * (1 - fractionX) + corners[1] * fractionX) * (1 - fractionY) + (corners[2] * (1 - fractionX) + corners[3] * fractionX) * fractionY;
+        if (std::abs(GetExactSample(band, checkPoint[0], checkPoint[1]) - interpolated) > maxError * 0.5)
+        {
+            return false;
+        }
     }
+
+    return true;
 }
 
-double Rasterizer::ComputeElevation(Point point)
+void Rasterizer::SampleQuad(AdaptiveBand& band, int x0, int y0, int x1, int y1)
 {
-    sf::Vector2i quadSquare = GetQuadtreeSquare(point);
-
-    // Loop forever as we are guaranteed to eventually find a point.
-    int gridDistance = 1;
-    std::vector<sf::Vector2i> searchQuads;
-
-    int maxIterations = 90; // Hard stop to handle edge cases where there won't be edge lines for the computer to find.
-    ElevationComputer elevationComputer = ElevationComputer(point);
-    while (maxIterations > 0)
+    // Every pixel of quads this small is a corner.
+    if (x1 - x0 <= 1 && y1 - y0 <= 1)
     {
-        --maxIterations;
-        searchQuads.clear();
-        AddAreasToSearch(gridDistance, quadSquare, searchQuads);
+        GetExactSample(band, x0, y0);
+        GetExactSample(band, x1, y0);
+        GetExactSample(band, x0, y1);
+        GetExactSample(band, x1, y1);
+        return;
+    }
 
-        // Iterate through each search region and each element in each region, processing the line with the computer
-        for (int k = 0; k < searchQuads.size(); k++)
+    if (IsQuadSmooth(band, x0, y0, x1, y1))
+    {
+        double corners[4] = { GetExactSample(band, x0, y0), GetExactSample(band, x1, y0), GetExactSample(band, x0, y1), GetExactSample(band, x1, y1) };
+        for (int y = y0; y <= y1; y++)
         {
-            int indexCount = (int)quadtree.ElementsInQuad(searchQuads[k]);
-            for (size_t i = 0; i < indexCount; i++)
+            double fractionY = y1 == y0 ? 0.0 : (double)(y - y0) / (double)(y1 - y0);
+            for (int x = x0; x <= x1; x++)
             {
-                Index index = quadtree.GetIndexFromQuad(searchQuads[k], (int)i);
-                LineStrip& lineStrip = lineStrips->lineStrips[index.stripIdx];
-
-                if (this->settings->IsHighResolution)
-                {
-                    Point start = lineStrip.points[index.pointIdx];
-                    Point end = lineStrip.points[index.pointIdx + 1];
-                    elevationComputer.ProcessLine(start, end, lineStrip.elevation);
-                }
-                else
+                size_t index = (size_t)x + (size_t)y * (band.width + 1);
+                if (!band.isExact[index])
                 {
-                    LowResPoint& start = lineStrip.lowResPoints[index.pointIdx];
-                    LowResPoint& end = lineStrip.lowResPoints[index.pointIdx + 1];
-                    elevationComputer.ProcessLine(Point((double)start.x, (double)start.y), Point((double)end.x, (double)end.y), lineStrip.elevation);
+                    double fractionX = x1 == x0 ? 0.0 : (double)(x - x0) / (double)(x1 - x0);
+                    band.samples[index] = (corners[0] * (1 - fractionX) + corners[1] * fractionX) * (1 - fractionY) + (corners[2] * (1 - fractionX) + corners[3] * fractionX) * fractionY;
                 }
             }
+        }
 
-            if (elevationComputer.HasSufficientData())
-            {
-                return elevationComputer.GetWeightedElevation();
-            }
+        return;
+    }
+
+    // Quads a pixel across only split the other way.
+    int centerX = (x0 + x1) / 2;
+    int centerY = (y0 + y1) / 2;
+    bool isSplittingX = x1 - x0 > 1;
+    bool isSplittingY = y1 - y0 > 1;
+    if (isSplittingX && isSplittingY)
+    {
+        SampleQuad(band, x0, y0, centerX, centerY);
+        SampleQuad(band, centerX, y0, x1, centerY);
+        SampleQuad(band, x0, centerY, centerX, y1);
+        SampleQuad(band, centerX, centerY, x1, y1);
+    }
+    else if (isSplittingX)
+    {
+        SampleQuad(band, x0, y0, centerX, y1);
+        SampleQuad(band, centerX, y0, x1, y1);
+    }
+    else
+    {
+        SampleQuad(band, x0, y0, x1, centerY);
+        SampleQuad(band, x0, centerY, x1, y1);
+    }
+}
+
+void Rasterizer::ComputeAdaptiveBand(const GeometryLevel& level, double leftOffset, double topOffset, double effectiveSize, int startColumn, double* rasterStore, RasterCost* costStore)
+{
+    AdaptiveBand band;
+    band.level = &level;
+    band.leftOffset = leftOffset;
+    band.topOffset = topOffset;
+    band.effectiveSize = effectiveSize;
+    band.startColumn = startColumn;
+    band.width = std::min(AdaptiveLatticeSize, size - 1 - startColumn);
+    band.samples.assign((size_t)(band.width + 1) * size, 0.0);
+    band.isExact.assign((size_t)(band.width + 1) * size, false);
+    band.contourDistances.assign((size_t)(band.width + 1) * size, 0.0f);
+    band.costStore = costStore;
+    band.exactPixelCount = 0;
+
+    int bandColumns = std::min(AdaptiveLatticeSize, size - startColumn);
+    if (costStore != nullptr)
+    {
+        for (int y = 0; y < size; y++)
+        {
+            std::fill(&costStore[startColumn + y * size], &costStore[startColumn + y * size] + bandColumns, RasterCost());
         }
+    }
 
-        // Increment the grids we search.
-        ++gridDistance;
+    for (int y = 0; y < size - 1; y += AdaptiveLatticeSize)
+    {
+        SampleQuad(band, 0, y, band.width, std::min(y + AdaptiveLatticeSize, size - 1));
     }
 
-    return elevationComputer.GetWeightedElevation();
+    for (int y = 0; y < size; y++)
+    {
+        std::copy(&band.samples[(size_t)y * (band.width + 1)], &band.samples[(size_t)y * (band.width + 1)] + bandColumns, &rasterStore[startColumn + y * size]);
+    }
+
+    exactPixelCount += band.exactPixelCount;
 }
 
-// Rasterizes a range of columns to improve perf.
-void Rasterizer::RasterizeColumn(double leftOffset, double topOffset, double effectiveSize, int column, double** rasterStore, volatile bool* isRunning)
+void Rasterizer::FinishColumn(int column)
 {
-    for (int j = 0; j < size; j++)
+    std::lock_guard<std::mutex> lock(finishedColumnsMutex);
+
+    // Adaptive sampling finishes a band of columns at once, from its first column.
+    if (settings->MaxError > 0)
     {
-        double x = leftOffset + ((double)column / (double)size) * effectiveSize;
-        double y = topOffset + ((double)j / (double)size) * effectiveSize;
+        if (column % AdaptiveLatticeSize == 0)
+        {
+            for (int bandColumn = column; bandColumn < std::min(column + AdaptiveLatticeSize, size); bandColumn++)
+            {
+                finishedColumns.push_back(bandColumn);
+            }
+        }
 
-        Point point(x, y);
-        double elevation = ComputeElevation(point);
-        (*rasterStore)[column + j * size] = elevation;
+        return;
     }
 
+    finishedColumns.push_back(column);
+}
+
+void Rasterizer::TakeFinishedColumns(std::vector<int>& columns)
+{
+    std::lock_guard<std::mutex> lock(finishedColumnsMutex);
+    columns.insert(columns.end(), finishedColumns.begin(), finishedColumns.end());
+    finishedColumns.clear();
+}
+
+// Rasterizes a range of columns to improve perf.
+void Rasterizer::RasterizeColumn(double leftOffset, double topOffset, double effectiveSize, int column, double** rasterStore, RasterCost* costStore, volatile bool* isRunning)
+{
+    ComputeColumn(leftOffset, topOffset, effectiveSize, column, *rasterStore, costStore);
+    FinishColumn(column);
+
 	*isRunning = false;
 }
 
-void Rasterizer::Rasterize(double leftOffset, double topOffset, double effectiveSize, double** rasterStore)
+void Rasterizer::Rasterize(double leftOffset, double topOffset, double effectiveSize, double** rasterStore, RasterCost* costStore)
 {
     std::cout << "Region Rasterizing..." << std::endl;
+    {
+        std::lock_guard<std::mutex> lock(finishedColumnsMutex);
+        finishedColumns.clear();
+    }
+
+    exactPixelCount = 0;
+
+    if (this->settings->IsNumaAware)
+    {
+        if (!numaWorkerPool)
+        {
+            numaWorkerPool.reset(new WorkerPool(0, true));
+        }
+
+        numaWorkerPool->ParallelFor(size, [&](int column)
+        {
+            ComputeColumn(leftOffset, topOffset, effectiveSize, column, *rasterStore, costStore);
+            FinishColumn(column);
+        });
+
+        std::cout << "Region Rasterization complete." << std::endl;
+        ReportAdaptiveSampling();
+        return;
+    }
 
     // Split apart rasterization across all cores - 1, or 7 if we can't find hardware cores.
     unsigned int hardwareThreads = std::thread::hardware_concurrency();
@@ -192,7 +461,7 @@ void Rasterizer::Rasterize(double leftOffset, double topOffset, double effective
 		threadsRunning[i] = true;
 		currentThreadColumn[i] = threadColumnOffset;
 		rasterizedColumns[currentThreadColumn[i]] = true;
-        threads[i] = new std::thread(&Rasterizer::RasterizeColumn, this, leftOffset, topOffset, effectiveSize, threadColumnOffset, rasterStore, &threadsRunning[i]);
+        threads[i] = new std::thread(&Rasterizer::RasterizeColumn, this, leftOffset, topOffset, effectiveSize, threadColumnOffset, rasterStore, costStore, &threadsRunning[i]);
     }
 
 	bool columnsLeftToRasterize = true;
@@ -241,7 +510,7 @@ void Rasterizer::Rasterize(double leftOffset, double topOffset, double effective
 				{
 					threadsRunning[i] = true;
 					rasterizedColumns[nextColumnToRasterize] = true;
-					threads[i] = new std::thread(&Rasterizer::RasterizeColumn, this, leftOffset, topOffset, effectiveSize, nextColumnToRasterize, rasterStore, &threadsRunning[i]);
+					threads[i] = new std::thread(&Rasterizer::RasterizeColumn, this, leftOffset, topOffset, effectiveSize, nextColumnToRasterize, rasterStore, costStore, &threadsRunning[i]);
 				}
 			}
 			
@@ -258,11 +527,30 @@ void Rasterizer::Rasterize(double leftOffset, double topOffset, double effective
 	delete[] threadsRunning;
 	delete[] rasterizedColumns;
     std::cout << "Region Rasterization complete." << std::endl;
+    ReportAdaptiveSampling();
+}
+
+void Rasterizer::ReportAdaptiveSampling()
+{
+    if (settings->MaxError <= 0)
+    {
+        return;
+    }
+
+    long long pixelCount = (long long)size * (long long)size;
+    totalExactPixelCount += exactPixelCount;
+    totalPixelCount += pixelCount;
+    std::cout << "  Adaptive sampling searched " << (100.0 * (double)exactPixelCount / (double)pixelCount) << "% of the pixels exactly (" <<
+        (100.0 * (double)totalExactPixelCount / (double)totalPixelCount) << "% of all regions so far)." << std::endl;
 }
 
 // Rasterizes a range of lines to improve perf.
+template <typename T>
 void Rasterizer::RasterizeLineColumnRange(double leftOffset, double topOffset, double effectiveSize, int startColumn, int columnCount, double** rasterStore)
 {
+    const GeometryLevel& level = GetLevel(effectiveSize);
+    std::vector<Index> nearbySegments;
+
     for (int i = startColumn; i < startColumn + columnCount; i++)
     {
         for (int j = 0; j < size; j++) // Column from top to bottom.
@@ -272,57 +560,36 @@ void Rasterizer::RasterizeLineColumnRange(double leftOffset, double topOffset, d
             double wiggleDistSqd = pow(effectiveSize / (double)size, 2)*2;
 
             Point point(x, y);
-            sf::Vector2i quadSquare = GetQuadtreeSquare(point);
+            nearbySegments.clear();
+            level.index->FindSegmentsNear(point, std::sqrt(wiggleDistSqd), nearbySegments);
 
             bool onPoint = false;
-            for (size_t k = 0; k < quadtree.ElementsInQuad(quadSquare); k++)
+            for (size_t k = 0; k < nearbySegments.size(); k++)
             {
-                Index index = quadtree.GetIndexFromQuad(quadSquare, (int)k);
+                T storedStart, storedEnd;
+                level.lineStrips->GetStoredSegment(nearbySegments[k], &storedStart, &storedEnd);
+                Point start = ToPoint(storedStart);
+                Point end = ToPoint(storedEnd);
 
-                if (this->settings->IsHighResolution)
+                if (std::pow(start.x - point.x, 2) + std::pow(start.y - point.y, 2) < wiggleDistSqd)
                 {
-                    Point start = lineStrips->lineStrips[index.stripIdx].points[index.pointIdx];
-                    Point end = lineStrips->lineStrips[index.stripIdx].points[index.pointIdx + 1];
-
-                    if (std::pow(start.x - point.x, 2) + std::pow(start.y - point.y, 2) < wiggleDistSqd)
-                    {
-                        onPoint = true;
-                        break;
-                    }
-
-                    if (std::pow(end.x - point.x, 2) + std::pow(end.y - point.y, 2) < wiggleDistSqd)
-                    {
-                        onPoint = true;
-                        break;
-                    }
+                    onPoint = true;
+                    break;
                 }
-                else
-                {
-                    LowResPoint start = lineStrips->lineStrips[index.stripIdx].lowResPoints[index.pointIdx];
-                    LowResPoint end = lineStrips->lineStrips[index.stripIdx].lowResPoints[index.pointIdx + 1];
-
-                    if (std::pow(start.x - point.x, 2) + std::pow(start.y - point.y, 2) < wiggleDistSqd)
-                    {
-                        onPoint = true;
-                        break;
-                    }
 
-                    if (std::pow(end.x - point.x, 2) + std::pow(end.y - point.y, 2) < wiggleDistSqd)
-                    {
-                        onPoint = true;
-                        break;
-                    }
+                if (std::pow(end.x - point.x, 2) + std::pow(end.y - point.y, 2) < wiggleDistSqd)
+                {
+                    onPoint = true;
+                    break;
                 }
             }
 
             bool filled = false;
             if (!onPoint)
             {
-                for (size_t k = 0; k < quadtree.ElementsInQuad(quadSquare); k++)
+                for (size_t k = 0; k < nearbySegments.size(); k++)
                 {
-                    Index index = quadtree.GetIndexFromQuad(quadSquare, (int)k);
-
-                    double lineDistSqd = GetLineDistanceSqd(index, point);
+                    double lineDistSqd = GetLineDistanceSqd<T>(level, nearbySegments[k], point);
                     if (lineDistSqd < wiggleDistSqd)
                     {
                         filled = true;
@@ -354,7 +621,7 @@ void Rasterizer::LineRaster(double leftOffset, double topOffset, double effectiv
     for (int i = 0; i < splitFactor; i++)
     {
         int actualRange = (i == splitFactor - 1) ? (size - range * splitFactor) + range : range;
-        threads[i] = new std::thread(&Rasterizer::RasterizeLineColumnRange, this, leftOffset, topOffset, effectiveSize, i * range, actualRange, rasterStore);
+        threads[i] = new std::thread(rasterizeLineColumnRange, this, leftOffset, topOffset, effectiveSize, i * range, actualRange, rasterStore);
     }
 
     for (int i = 0; i < splitFactor; i++)
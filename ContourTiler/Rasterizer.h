@@ -1,117 +1,126 @@
 #pragma once
-#include <SFML\System.hpp>
-#include <SFML\Graphics.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <vector>
+#include "GeometryLevel.h"
 #include "LineStripLoader.h"
-#include "Quadtree.h"
+#include "RasterCost.h"
+#include "WorkerPool.h"
 
 class Rasterizer
 {
     Settings* settings;
     LineStripLoader* lineStrips;
-    Quadtree quadtree;
 
-    // The number of quadtree xy grid spaces.
+    // Geometry from full detail (first) to the coarsest simplification (last).
+    std::vector<std::unique_ptr<GeometryLevel>> levels;
+
+    // With --Numa, copies of the levels for each NUMA node, each allocated and indexed by a thread pinned to that node.
+    std::vector<std::vector<std::unique_ptr<GeometryLevel>>> nodeLevels;
+
+    // With --Numa, threads pinned to each node that rasterize the columns of a region. Created on first use.
+    std::unique_ptr<WorkerPool> numaWorkerPool;
+
+    // Columns of the current Rasterize call finished since they were last taken, for displays to update only what changed.
+    std::mutex finishedColumnsMutex;
+    std::vector<int> finishedColumns;
+    void FinishColumn(int column);
+
+    // Returns the coarsest level that stays within half a pixel of the input at the given zoom, from the calling thread's node if replicated.
+    const GeometryLevel& GetLevel(double effectiveSize) const;
+
+    // Copies the levels onto each NUMA node.
+    void ReplicateLevels();
+
+    // The number of pixels in each direction, which is also the number of grid index squares.
     int size;
 
-    // Map the given (normalized) points to 0-(size - 1) (defaults to 0-9) for block-based lookup.
-    template <typename T>
-    sf::Vector2i GetQuadtreeSquare(T givenPoint)
-    {
-        return sf::Vector2i(
-            std::min((int)(givenPoint.x * (double)size), size - 1),
-            std::min((int)(givenPoint.y * (double)size), size - 1));
-    }
+    // The most square counts a grid index holds at once while it is built.
+    size_t maxIndexCountEntries;
 
-    template <typename T>
-    void AddPointsToQuadtree(int lineStripIndex, std::vector<T> points)
+    // With --MaxError, pixels are searched exactly on a lattice of this spacing, with the quads between subdivided until smooth.
+    static const int AdaptiveLatticeSize = 16;
+
+    // The distinct (normalized) contour elevations, and the maximum error normalized the same way.
+    std::vector<double> contourElevations;
+    double maxError;
+
+    // Pixels searched exactly, for the current Rasterize call and all calls, to report how much adaptive sampling saved.
+    std::atomic<long long> exactPixelCount;
+    long long totalExactPixelCount;
+    long long totalPixelCount;
+
+    // Samples of a band of columns being adaptively rasterized, including the lattice column after the band.
+    struct AdaptiveBand
     {
-        for (unsigned int j = 0; j < points.size() - 1; j++)
-        {
-            sf::Vector2i quadStart = GetQuadtreeSquare(points[j]);
-            sf::Vector2i quadEnd = GetQuadtreeSquare(points[j + 1]);
-            Index index(lineStripIndex, j);
-
-            // Add the start
-            quadtree.AddToIndex(quadStart, index);
-
-            // Add where the line intersects to the quadtree, iterating in the length where our V1 algorithm works.
-            sf::Vector2i distance = quadEnd - quadStart;
-            if (quadEnd.x == quadStart.x && quadEnd.y == quadStart.y)
-            {
-                continue;
-            }
-            else if (std::abs(distance.x) >= std::abs(distance.y))
-            {
-                // Iterate X, going in the negative or positive direction appropriately.
-                int x = quadStart.x;
-                const int increment = quadStart.x < quadEnd.x ? 1 : -1;
-                const float yDelta = (float)distance.y / (float)std::abs(distance.x);
-            
-                int currentX = 0;
-                while (x != quadEnd.x)
-                {
-                    x += increment;
-                    ++currentX;
-            
-                    int y = (int)(yDelta * currentX + quadStart.y);
-            
-                    // V1: Add to both Y plus and minus 1 to be pessimistic
-                    quadtree.AddToIndex(sf::Vector2i(x, y), index);
-                    quadtree.AddToIndex(sf::Vector2i(x, y + 1), index);
-                    quadtree.AddToIndex(sf::Vector2i(x, y - 1), index);
-                }
-            }
-            else
-            {
-                // Iterate Y, going in the negative or positive direction appropriately.
-                int y = quadStart.y;
-                const int increment = quadStart.y < quadEnd.y ? 1 : -1;
-                const float xDelta = (float)distance.x / (float)std::abs(distance.y);
-            
-                int currentY = 0;
-                while (y != quadEnd.y)
-                {
-                    y += increment;
-                    ++currentY;
-            
-                    int x = (int)(xDelta * currentY + quadStart.x);
-            
-                    // V1: Add to both X plus and minus 1 to be pessimistic
-                    quadtree.AddToIndex(sf::Vector2i(x, y), index);
-                    quadtree.AddToIndex(sf::Vector2i(x + 1, y), index);
-                    quadtree.AddToIndex(sf::Vector2i(x - 1, y), index);
-                }
-            }
-        }
-    }
+        const GeometryLevel* level;
+        double leftOffset, topOffset, effectiveSize;
+        int startColumn;
+        int width;
+        std::vector<double> samples;
+        std::vector<bool> isExact;
 
-    // Gets the closest distance from a point to a line ensuring we account for endpoints.
-    double GetLineDistanceSqd(Index idx, Point point);
+        // Distance of each exact sample to its nearest contour, in pixels.
+        std::vector<float> contourDistances;
+        RasterCost* costStore;
+        long long exactPixelCount;
+    };
 
-    // Adds an area if it is valid.
-    void AddIfValid(int xP, int yP, std::vector<sf::Vector2i>& searchQuads);
+    // Gets the sample at the band coordinates, searching for it exactly if it hasn't been.
+    double GetExactSample(AdaptiveBand& band, int x, int y);
 
-    // Adds areas to search given the current point and distance away from it.
-    void AddAreasToSearch(int distance, sf::Vector2i startQuad, std::vector<sf::Vector2i>& searchQuads);
+    // Returns true if the quad is smooth enough to interpolate from its corners.
+    bool IsQuadSmooth(AdaptiveBand& band, int x0, int y0, int x1, int y1);
 
-    // Returns the height of the closest point to the specified coordinates.
-    double ComputeElevation(Point point);
+    // Fills the quad by interpolating its corners, or recursively subdivides it if not smooth.
+    void SampleQuad(AdaptiveBand& band, int x0, int y0, int x1, int y1);
+
+    // Rasterizes the band of columns starting at a lattice column.
+    void ComputeAdaptiveBand(const GeometryLevel& level, double leftOffset, double topOffset, double effectiveSize, int startColumn, double* rasterStore, RasterCost* costStore);
+
+    // Logs the fraction of pixels searched exactly by the last Rasterize call, if sampling adaptively.
+    void ReportAdaptiveSampling();
+
+    // Creates and fills in the level's index with all the lines within the area.
+    void IndexLevel(GeometryLevel& level);
+
+    // Gets the closest distance from a point to a line ensuring we account for endpoints.
+    template <typename T>
+    double GetLineDistanceSqd(const GeometryLevel& level, Index idx, Point point);
+
+    // Returns the height of the closest point to the specified coordinates, recording the search cost and distance to the nearest line if provided.
+    double ComputeElevation(const GeometryLevel& level, Point point, RasterCost* cost, double* nearestDistanceSqd = nullptr);
 
     // Rasterizes a single column to improve perf.
-    void RasterizeColumn(double leftOffset, double topOffset, double effectiveSize, int column, double** rasterStore, volatile bool* isRunning);
+    void RasterizeColumn(double leftOffset, double topOffset, double effectiveSize, int column, double** rasterStore, RasterCost* costStore, volatile bool* isRunning);
 
-    // Rasterizes a range of lines to improve perf.
+    // Rasterizes a range of lines to improve perf, reading the segments as stored in the arena of type T.
+    template <typename T>
     void RasterizeLineColumnRange(double leftOffset, double topOffset, double effectiveSize, int startColumn, int columnCount, double** rasterStore);
 
+    // The specialization of RasterizeLineColumnRange for the lines, chosen by Setup.
+    typedef void (Rasterizer::*LineColumnRangeFunction)(double leftOffset, double topOffset, double effectiveSize, int startColumn, int columnCount, double** rasterStore);
+    LineColumnRangeFunction rasterizeLineColumnRange;
+
 public:
     Rasterizer(LineStripLoader* lineStripLoader);
 
+    // Limits the memory of building the grid indexes, by how many square counts are held at once. Must be called before Setup.
+    void SetMaxIndexCountEntries(size_t maxCountEntries);
+
     // Setup to be done before rasterization can be performed.
     void Setup(Settings* settings);
 
-    // Rasterizes the area, filling in the raster store.
-    void Rasterize(double leftOffset, double topOffset, double effectiveSize, double** rasterStore);
+    // Rasterizes the area, filling in the raster store. If provided, the cost store is filled with the per-pixel search cost.
+    void Rasterize(double leftOffset, double topOffset, double effectiveSize, double** rasterStore, RasterCost* costStore = nullptr);
+
+    // Moves the columns finished since the last call (or the start of Rasterize) into the list.
+    void TakeFinishedColumns(std::vector<int>& columns);
+
+    // Rasterizes a single column of the area on the calling thread, for callers that manage their own threads.
+    // With --MaxError, lattice columns compute their whole band of columns and the other columns do nothing.
+    void ComputeColumn(double leftOffset, double topOffset, double effectiveSize, int column, double* rasterStore, RasterCost* costStore);
 
     // Rasterizes in lines with full whiteness.
     void LineRaster(double leftOffset, double topOffset, double effectiveSize, double** rasterStore);
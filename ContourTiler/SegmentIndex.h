@@ -0,0 +1,24 @@
+#pragma once
+#include <vector>
+#include "ElevationComputer.h"
+#include "Index.h"
+#include "LineStripSet.h"
+#include "Point.h"
+#include "RasterCost.h"
+
+// Spatial lookup of the line strip segments, used to find the lines nearest to each rasterized point.
+class SegmentIndex
+{
+public:
+    virtual ~SegmentIndex()
+    { }
+
+    // Indexes all segments of the line strips, which must outlive the index.
+    virtual void Build(const LineStripSet* lineStrips) = 0;
+
+    // Processes the lines around the point with the computer until it has enough to compute the elevation, recording the search cost if provided.
+    virtual void Search(Point point, ElevationComputer& elevationComputer, RasterCost* cost) const = 0;
+
+    // Finds the segments that may be within the distance of the point, for drawing the lines. A segment may be found more than once.
+    virtual void FindSegmentsNear(Point point, double distance, std::vector<Index>& segments) const = 0;
+};
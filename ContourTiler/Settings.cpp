@@ -5,23 +5,21 @@
 
 // Setup defaults
 Settings::Settings()
-    : IsHighResolution(true), ElevationFeature("Elevation"), GeoJsonFiles(), OutputFolder("rasters"), RegionCount(10), RegionSize(800)
+    : ElevationFeature("Elevation"), RegionCount(10), RegionSize(800), OutputFolder("rasters"), OutputFormat(TileFormat::Png), PngLevel(6), IsHighResolution(true), IsQuantized(false), IsRTreeIndex(false), MaxError(0.0), HasBounds(false), BoundsMinX(0.0), BoundsMinY(0.0), BoundsMaxX(0.0), BoundsMaxY(0.0), BoundsMargin(0.1), ExportCostMaps(false), SimplifyTolerance(0.0), IsSimplifyToleranceInPixels(true), LodLevels(1), IsOutOfCore(false), MemoryBudget(1024), BucketHalo(1), IsNumaAware(false), HasTileRange(false), TileRangeMinX(0), TileRangeMinY(0), TileRangeMaxX(0), TileRangeMaxY(0), ShardIndex(0), ShardCount(0), IsMerging(false), IsBuildingPyramid(false), PyramidFilter(PyramidReduction::Mean), IsPacking(false), IsServing(false), ServerPort(8080), CacheSize(256), InputFiles()
 {
 }
 
-bool Settings::endsWithGeoJson(std::string argument)
+bool Settings::endsWithCaseInsensitive(std::string argument, std::string suffix)
 {
-    std::string geoJsonKeyword(".geojson");
-
-    if (argument.length() < geoJsonKeyword.length())
+    if (argument.length() < suffix.length())
     {
         return false;
     }
 
     int counter = 0;
-    for (size_t i = argument.length() - geoJsonKeyword.length(); i < geoJsonKeyword.length(); i++, counter++)
+    for (size_t i = argument.length() - suffix.length(); i < argument.length(); i++, counter++)
     {
-        if (std::toupper(argument[i]) != std::toupper(geoJsonKeyword[counter]))
+        if (std::toupper(argument[i]) != std::toupper(suffix[counter]))
         {
             return false;
         }
@@ -30,6 +28,11 @@ bool Settings::endsWithGeoJson(std::string argument)
     return true;
 }
 
+bool Settings::isInputFile(std::string argument)
+{
+    return endsWithCaseInsensitive(argument, ".geojson") || endsWithCaseInsensitive(argument, ".shp");
+}
+
 bool Settings::equalsCaseInsensitive(std::string a, std::string b)
 {
     if (a.length() != b.length())
@@ -48,32 +51,37 @@ bool Settings::equalsCaseInsensitive(std::string a, std::string b)
     return true;
 }
 
+bool Settings::IsTileInRange(int regionX, int regionY) const
+{
+    return regionX >= TileRangeMinX && regionX <= TileRangeMaxX && regionY >= TileRangeMinY && regionY <= TileRangeMaxY;
+}
+
 bool Settings::ParseArguments(int argc, const char* argv[])
 {
     if (argc == 1)
     {
-        std::cout << "At least one geojson input file must be provided!" << std::endl;
+        std::cout << "At least one GeoJSON or shapefile input file must be provided!" << std::endl;
         return false;
     }
 
-    bool parsingGeoJson = true;
+    bool parsingInputs = true;
     for (int i = 1; i < argc; i++)
     {
         bool parsedInput = false;
-        if (parsingGeoJson)
+        if (parsingInputs)
         {
-            if (endsWithGeoJson(argv[i]))
+            if (isInputFile(argv[i]))
             {
-                this->GeoJsonFiles.push_back(std::string(argv[i]));
+                this->InputFiles.push_back(std::string(argv[i]));
                 parsedInput = true;
             }
             else
             {
-                parsingGeoJson = false;
+                parsingInputs = false;
             }
         }
 
-        if (!parsingGeoJson)
+        if (!parsingInputs)
         {
             // See if this is an option, and if so, parse and continue
             if (equalsCaseInsensitive("--Feature", argv[i]) || equalsCaseInsensitive("-Feature", argv[i]))
@@ -147,11 +155,450 @@ bool Settings::ParseArguments(int argc, const char* argv[])
                 parsedInput = true;
             }
 
+            if (equalsCaseInsensitive("--OutputFormat", argv[i]) || equalsCaseInsensitive("-OutputFormat", argv[i]))
+            {
+                if (i + 1 == argc)
+                {
+                    std::cout << "No format was found after '--OutputFormat'!" << std::endl;
+                    return false;
+                }
+
+                i++;
+                std::string format(argv[i]);
+                if (equalsCaseInsensitive("png", format))
+                {
+                    this->OutputFormat = TileFormat::Png;
+                }
+                else if (equalsCaseInsensitive("terrain", format))
+                {
+                    this->OutputFormat = TileFormat::Terrain;
+                }
+                else
+                {
+                    std::cout << "The output format must be 'png' or 'terrain'! Found '" << format << "'." << std::endl;
+                    return false;
+                }
+
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--PngLevel", argv[i]) || equalsCaseInsensitive("-PngLevel", argv[i]))
+            {
+                if (i + 1 == argc)
+                {
+                    std::cout << "No level was found after '--PngLevel'!" << std::endl;
+                    return false;
+                }
+
+                i++;
+                std::istringstream inputStream(argv[i]);
+                if (inputStream >> this->PngLevel ? false : true)
+                {
+                    std::cout << "Unable to parse the PNG level as an integer!" << std::endl;
+                    return false;
+                }
+
+                if (this->PngLevel < 0 || this->PngLevel > 9)
+                {
+                    std::cout << "The PNG level must be from 0 to 9! Found '" << this->PngLevel << "'." << std::endl;
+                    return false;
+                }
+
+                parsedInput = true;
+            }
+
             if (equalsCaseInsensitive("--LowResolution", argv[i]) || equalsCaseInsensitive("-LowResolution", argv[i]))
             {
                 this->IsHighResolution = false;
                 parsedInput = true;
             }
+
+            if (equalsCaseInsensitive("--Quantized", argv[i]) || equalsCaseInsensitive("-Quantized", argv[i]))
+            {
+                this->IsQuantized = true;
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--Index", argv[i]) || equalsCaseInsensitive("-Index", argv[i]) ||
+                equalsCaseInsensitive("--Index=grid", argv[i]) || equalsCaseInsensitive("--Index=rtree", argv[i]))
+            {
+                std::string indexType;
+                std::string argument(argv[i]);
+                if (argument.find('=') != std::string::npos)
+                {
+                    indexType = argument.substr(argument.find('=') + 1);
+                }
+                else if (i + 1 == argc)
+                {
+                    std::cout << "No index type was found after '--Index'!" << std::endl;
+                    return false;
+                }
+                else
+                {
+                    i++;
+                    indexType = std::string(argv[i]);
+                }
+
+                if (!equalsCaseInsensitive("grid", indexType) && !equalsCaseInsensitive("rtree", indexType))
+                {
+                    std::cout << "The index type must be 'grid' or 'rtree'! Found '" << indexType << "'." << std::endl;
+                    return false;
+                }
+
+                this->IsRTreeIndex = equalsCaseInsensitive("rtree", indexType);
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--Pyramid", argv[i]) || equalsCaseInsensitive("-Pyramid", argv[i]))
+            {
+                this->IsBuildingPyramid = true;
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--Pack", argv[i]) || equalsCaseInsensitive("-Pack", argv[i]))
+            {
+                this->IsPacking = true;
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--PyramidFilter", argv[i]) || equalsCaseInsensitive("-PyramidFilter", argv[i]))
+            {
+                if (i + 1 == argc)
+                {
+                    std::cout << "No filter was found after '--PyramidFilter'!" << std::endl;
+                    return false;
+                }
+
+                i++;
+                std::string filter(argv[i]);
+                if (equalsCaseInsensitive("mean", filter))
+                {
+                    this->PyramidFilter = PyramidReduction::Mean;
+                }
+                else if (equalsCaseInsensitive("min", filter))
+                {
+                    this->PyramidFilter = PyramidReduction::Min;
+                }
+                else if (equalsCaseInsensitive("max", filter))
+                {
+                    this->PyramidFilter = PyramidReduction::Max;
+                }
+                else
+                {
+                    std::cout << "The pyramid filter must be 'mean', 'min' or 'max'! Found '" << filter << "'." << std::endl;
+                    return false;
+                }
+
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--MaxError", argv[i]) || equalsCaseInsensitive("-MaxError", argv[i]))
+            {
+                if (i + 1 == argc)
+                {
+                    std::cout << "No error was found after '--MaxError'!" << std::endl;
+                    return false;
+                }
+
+                i++;
+                std::istringstream inputStream(argv[i]);
+                if (inputStream >> this->MaxError ? false : true)
+                {
+                    std::cout << "Unable to parse the maximum error as a number!" << std::endl;
+                    return false;
+                }
+
+                if (this->MaxError < 0)
+                {
+                    std::cout << "The maximum error cannot be negative! Found '" << this->MaxError << "'." << std::endl;
+                    return false;
+                }
+
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--Bounds", argv[i]) || equalsCaseInsensitive("-Bounds", argv[i]))
+            {
+                if (i + 1 == argc)
+                {
+                    std::cout << "No bounds were found after '--Bounds'!" << std::endl;
+                    return false;
+                }
+
+                i++;
+                std::istringstream inputStream(argv[i]);
+                char separators[3];
+                if (!(inputStream >> this->BoundsMinX >> separators[0] >> this->BoundsMinY >> separators[1] >> this->BoundsMaxX >> separators[2] >> this->BoundsMaxY) ||
+                    separators[0] != ',' || separators[1] != ',' || separators[2] != ',')
+                {
+                    std::cout << "Unable to parse the bounds as 'minX,minY,maxX,maxY'!" << std::endl;
+                    return false;
+                }
+
+                if (this->BoundsMinX >= this->BoundsMaxX || this->BoundsMinY >= this->BoundsMaxY)
+                {
+                    std::cout << "The bounds minimums must be less than the maximums!" << std::endl;
+                    return false;
+                }
+
+                this->HasBounds = true;
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--BoundsMargin", argv[i]) || equalsCaseInsensitive("-BoundsMargin", argv[i]))
+            {
+                if (i + 1 == argc)
+                {
+                    std::cout << "No margin was found after '--BoundsMargin'!" << std::endl;
+                    return false;
+                }
+
+                i++;
+                std::istringstream inputStream(argv[i]);
+                if (inputStream >> this->BoundsMargin ? false : true)
+                {
+                    std::cout << "Unable to parse the bounds margin as a number!" << std::endl;
+                    return false;
+                }
+
+                if (this->BoundsMargin < 0)
+                {
+                    std::cout << "The bounds margin cannot be negative! Found '" << this->BoundsMargin << "'." << std::endl;
+                    return false;
+                }
+
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--CostMaps", argv[i]) || equalsCaseInsensitive("-CostMaps", argv[i]))
+            {
+                this->ExportCostMaps = true;
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--SimplifyPixels", argv[i]) || equalsCaseInsensitive("-SimplifyPixels", argv[i]) ||
+                equalsCaseInsensitive("--SimplifySource", argv[i]) || equalsCaseInsensitive("-SimplifySource", argv[i]))
+            {
+                this->IsSimplifyToleranceInPixels = equalsCaseInsensitive("--SimplifyPixels", argv[i]) || equalsCaseInsensitive("-SimplifyPixels", argv[i]);
+                if (i + 1 == argc)
+                {
+                    std::cout << "No simplification tolerance was found after '" << argv[i] << "'!" << std::endl;
+                    return false;
+                }
+
+                i++;
+                std::istringstream inputStream(argv[i]);
+                if (inputStream >> this->SimplifyTolerance ? false : true)
+                {
+                    std::cout << "Unable to parse the simplification tolerance as a number!" << std::endl;
+                    return false;
+                }
+
+                if (this->SimplifyTolerance < 0)
+                {
+                    std::cout << "The simplification tolerance cannot be negative! Found '" << this->SimplifyTolerance << "'." << std::endl;
+                    return false;
+                }
+
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--LodLevels", argv[i]) || equalsCaseInsensitive("-LodLevels", argv[i]))
+            {
+                if (i + 1 == argc)
+                {
+                    std::cout << "No level count was found after '--LodLevels'!" << std::endl;
+                    return false;
+                }
+
+                i++;
+                std::istringstream inputStream(argv[i]);
+                if (inputStream >> this->LodLevels ? false : true)
+                {
+                    std::cout << "Unable to parse the level of detail count as an integer!" << std::endl;
+                    return false;
+                }
+
+                if (this->LodLevels < 1)
+                {
+                    std::cout << "The level of detail count must be at least 1! Found '" << this->LodLevels << "'." << std::endl;
+                    return false;
+                }
+
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--OutOfCore", argv[i]) || equalsCaseInsensitive("-OutOfCore", argv[i]))
+            {
+                this->IsOutOfCore = true;
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--MemoryBudget", argv[i]) || equalsCaseInsensitive("-MemoryBudget", argv[i]))
+            {
+                if (i + 1 == argc)
+                {
+                    std::cout << "No memory budget was found after '--MemoryBudget'!" << std::endl;
+                    return false;
+                }
+
+                i++;
+                std::istringstream inputStream(argv[i]);
+                if (inputStream >> this->MemoryBudget ? false : true)
+                {
+                    std::cout << "Unable to parse the memory budget as an integer!" << std::endl;
+                    return false;
+                }
+
+                if (this->MemoryBudget < 1)
+                {
+                    std::cout << "The memory budget must be at least 1 MiB! Found '" << this->MemoryBudget << "'." << std::endl;
+                    return false;
+                }
+
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--BucketHalo", argv[i]) || equalsCaseInsensitive("-BucketHalo", argv[i]))
+            {
+                if (i + 1 == argc)
+                {
+                    std::cout << "No halo size was found after '--BucketHalo'!" << std::endl;
+                    return false;
+                }
+
+                i++;
+                std::istringstream inputStream(argv[i]);
+                if (inputStream >> this->BucketHalo ? false : true)
+                {
+                    std::cout << "Unable to parse the bucket halo as an integer!" << std::endl;
+                    return false;
+                }
+
+                if (this->BucketHalo < 0)
+                {
+                    std::cout << "The bucket halo cannot be negative! Found '" << this->BucketHalo << "'." << std::endl;
+                    return false;
+                }
+
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--TileRange", argv[i]) || equalsCaseInsensitive("-TileRange", argv[i]))
+            {
+                if (i + 1 == argc)
+                {
+                    std::cout << "No tile range was found after '--TileRange'!" << std::endl;
+                    return false;
+                }
+
+                i++;
+                std::istringstream inputStream(argv[i]);
+                char separators[3];
+                if (!(inputStream >> this->TileRangeMinX >> separators[0] >> this->TileRangeMinY >> separators[1] >> this->TileRangeMaxX >> separators[2] >> this->TileRangeMaxY) ||
+                    separators[0] != ',' || separators[1] != ',' || separators[2] != ',')
+                {
+                    std::cout << "Unable to parse the tile range as 'x0,y0,x1,y1'!" << std::endl;
+                    return false;
+                }
+
+                this->HasTileRange = true;
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--Shard", argv[i]) || equalsCaseInsensitive("-Shard", argv[i]))
+            {
+                if (i + 1 == argc)
+                {
+                    std::cout << "No shard was found after '--Shard'!" << std::endl;
+                    return false;
+                }
+
+                i++;
+                std::istringstream inputStream(argv[i]);
+                char separator;
+                if (!(inputStream >> this->ShardIndex >> separator >> this->ShardCount) || separator != '/')
+                {
+                    std::cout << "Unable to parse the shard as 'k/N'!" << std::endl;
+                    return false;
+                }
+
+                if (this->ShardCount < 1 || this->ShardIndex < 0 || this->ShardIndex >= this->ShardCount)
+                {
+                    std::cout << "The shard must be between 0/N and (N-1)/N! Found '" << argv[i] << "'." << std::endl;
+                    return false;
+                }
+
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--Merge", argv[i]) || equalsCaseInsensitive("-Merge", argv[i]))
+            {
+                this->IsMerging = true;
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--Numa", argv[i]) || equalsCaseInsensitive("-Numa", argv[i]))
+            {
+                this->IsNumaAware = true;
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--Serve", argv[i]) || equalsCaseInsensitive("-Serve", argv[i]))
+            {
+                this->IsServing = true;
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--Port", argv[i]) || equalsCaseInsensitive("-Port", argv[i]))
+            {
+                if (i + 1 == argc)
+                {
+                    std::cout << "No port was found after '--Port'!" << std::endl;
+                    return false;
+                }
+
+                i++;
+                std::istringstream inputStream(argv[i]);
+                if (inputStream >> this->ServerPort ? false : true)
+                {
+                    std::cout << "Unable to parse the port as an integer!" << std::endl;
+                    return false;
+                }
+
+                if (this->ServerPort < 1 || this->ServerPort > 65535)
+                {
+                    std::cout << "The port must be between 1 and 65535! Found '" << this->ServerPort << "'." << std::endl;
+                    return false;
+                }
+
+                parsedInput = true;
+            }
+
+            if (equalsCaseInsensitive("--CacheSize", argv[i]) || equalsCaseInsensitive("-CacheSize", argv[i]))
+            {
+                if (i + 1 == argc)
+                {
+                    std::cout << "No cache size was found after '--CacheSize'!" << std::endl;
+                    return false;
+                }
+
+                i++;
+                std::istringstream inputStream(argv[i]);
+                if (inputStream >> this->CacheSize ? false : true)
+                {
+                    std::cout << "Unable to parse the cache size as an integer!" << std::endl;
+                    return false;
+                }
+
+                if (this->CacheSize < 0)
+                {
+                    std::cout << "The cache size cannot be negative! Found '" << this->CacheSize << "'." << std::endl;
+                    return false;
+                }
+
+                parsedInput = true;
+            }
         }
 
         if (!parsedInput)
@@ -161,29 +608,145 @@ bool Settings::ParseArguments(int argc, const char* argv[])
         }
     }
 
+    if (!ResolveTileRange())
+    {
+        return false;
+    }
+
+    // Parent tiles need all of their children, each covering exactly a quarter of the parent.
+    if (IsBuildingPyramid && HasTileRange)
+    {
+        std::cout << "'--Pyramid' needs every tile, so can't be combined with '--TileRange' or '--Shard'!" << std::endl;
+        return false;
+    }
+
+    if (IsBuildingPyramid && RegionSize % 2 != 0)
+    {
+        std::cout << "'--Pyramid' needs an even region size! Found '" << RegionSize << "'." << std::endl;
+        return false;
+    }
+
+    // The pack's directory is written by the one process that wrote every tile.
+    if (IsPacking && HasTileRange)
+    {
+        std::cout << "'--Pack' needs every tile, so can't be combined with '--TileRange' or '--Shard'!" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool Settings::ResolveTileRange()
+{
+    if (ShardCount != 0)
+    {
+        if (HasTileRange)
+        {
+            std::cout << "Only one of '--TileRange' and '--Shard' can be given!" << std::endl;
+            return false;
+        }
+
+        if (ShardCount > RegionCount)
+        {
+            std::cout << "There cannot be more shards than rows of tiles! Found " << ShardCount << " shards for " << RegionCount << " rows." << std::endl;
+            return false;
+        }
+
+        // Each shard is a contiguous band of rows, so it only needs the contours near that band.
+        TileRangeMinX = 0;
+        TileRangeMaxX = RegionCount - 1;
+        TileRangeMinY = ShardIndex * RegionCount / ShardCount;
+        TileRangeMaxY = (ShardIndex + 1) * RegionCount / ShardCount - 1;
+        HasTileRange = true;
+        return true;
+    }
+
+    if (!HasTileRange)
+    {
+        TileRangeMinX = 0;
+        TileRangeMinY = 0;
+        TileRangeMaxX = RegionCount - 1;
+        TileRangeMaxY = RegionCount - 1;
+        return true;
+    }
+
+    if (TileRangeMinX < 0 || TileRangeMinY < 0 || TileRangeMaxX >= RegionCount || TileRangeMaxY >= RegionCount ||
+        TileRangeMinX > TileRangeMaxX || TileRangeMinY > TileRangeMaxY)
+    {
+        std::cout << "The tile range must be within 0 to " << (RegionCount - 1) << ", with the minimums no greater than the maximums!" << std::endl;
+        return false;
+    }
+
     return true;
 }
 
 void Settings::OutputUsage()
 {
     std::cout << "Usage:" << std::endl;
-    std::cout << "  ContourTiler.exe InputFile1.geojson InputeFile2.geojson ... [options]" << std::endl;
+    std::cout << "  ContourTiler.exe InputFile1.geojson InputFile2.shp ... [options]" << std::endl;
     std::cout << std::endl;
     std::cout << "About:" << std::endl;
-    std::cout << "  ContourTiler takes in a series of GeoJSON files, displays them, and manages rasterizing them into image heightmap files." << std::endl;
-    std::cout << "  All provided GeoJSON files are combined together and rasterized together." << std::endl;
+    std::cout << "  ContourTiler takes in a series of GeoJSON files or shapefiles, displays them, and manages rasterizing them into image heightmap files." << std::endl;
+    std::cout << "  All provided input files are combined together and rasterized together." << std::endl;
     std::cout << std::endl;
     std::cout << "Input Format:" << std::endl;
-    std::cout << "  Input files should be GeoJSON files with contours stored as MultiLineString objects." << std::endl;
+    std::cout << "  Input files should be GeoJSON files with contours stored as MultiLineString objects, or Esri shapefiles (.shp) of PolyLine contours." << std::endl;
     std::cout << "  By default, the elevation is assumed to be in the 'Elevation' feature, but the --Feature argument can override this." << std::endl;
+    std::cout << "  Shapefile elevations are read from that numeric field of the .dbf table next to the .shp file." << std::endl;
     std::cout << std::endl;
     std::cout << "Options:" << std::endl;
-    std::cout << " --Feature [Feature]: Specifies the input feature containing the elevation of each MultiLineString. Defaults to 'Elevation'." << std::endl;
+    std::cout << " --Feature [Feature]: Specifies the input feature (or shapefile field) containing the elevation of each MultiLineString. Defaults to 'Elevation'." << std::endl;
     std::cout << " --RegionCount [Count]: Specifies the amount of tiling applied to the region. Defaults to 10 (which means 10x10 or 100 tiles are created)." << std::endl;
     std::cout << " --RegionSize [Size]: Specifies the size of each image created. Defaults to 800 (800x800 pixel images)." << std::endl;
     std::cout << "     This value should be around the size of your monitor, because the overview image is *also* rendered at this resolution. Use a higher region count if you need more detail." << std::endl;
     std::cout << " --OutputFolder [Folder]: Specifies the output folder rasterized images are placed. Defaults to 'rasters' (relative to the application). This folder must *not* exist." << std::endl;
+    std::cout << " --OutputFormat [png|terrain]: Specifies how the height tiles are encoded. Defaults to 'png'." << std::endl;
+    std::cout << "     'terrain' writes [X].cth tiles with a lossless codec for 16-bit heights, smaller and faster to encode and decode than PNG. See HeightCodec.h for the layout." << std::endl;
+    std::cout << " --PngLevel [Level]: Specifies the deflate level of PNG tiles, from 0 (stored uncompressed, fastest, for intermediate files) to 9 (smallest). Defaults to 6." << std::endl;
+    std::cout << "     Large tiles are compressed in bands of rows on all cores." << std::endl;
     std::cout << " --LowResolution: Stores geometry data in 32-bit format. Useful for low-memory or large geometry regions. The default is high-resolution." << std::endl;
+    std::cout << " --Quantized: Stores geometry data as 32-bit fixed point values. Uses the memory of --LowResolution with more precision than it. Overrides --LowResolution." << std::endl;
+    std::cout << " --Index [grid|rtree]: Specifies how the contours are indexed for the nearest-line search. Defaults to 'grid'." << std::endl;
+    std::cout << "     The grid stops once every direction has a line. 'rtree' finds the nearest line in every direction and is faster for very uneven contour density." << std::endl;
+    std::cout << " --MaxError [Elevation]: Samples adaptively, searching for the elevation exactly on a lattice every 16 pixels and only subdividing" << std::endl;
+    std::cout << "     where a contour crosses or the surface bends by more than [Elevation] (in input units). The rest is interpolated. Disabled (0) by default." << std::endl;
+    std::cout << "     This is a tolerance, not a maximum: the surface is only checked at sampled points, and steps between them can be missed." << std::endl;
+    std::cout << " --Bounds [minX,minY,maxX,maxY]: Only loads and tiles contours within this area, in input coordinates. Defaults to the extent of all inputs." << std::endl;
+    std::cout << " --BoundsMargin [Fraction]: Contours within this fraction of the bounds size outside the bounds are also loaded, for correct edges. Defaults to 0.1." << std::endl;
+    std::cout << " --CostMaps: Also writes a [X]_cost.png diagnostic image next to each rasterized image when bulk processing." << std::endl;
+    std::cout << "     Red is the number of search rings (or R-tree nodes) visited, green the filled sectors (x25) and blue the segments tested (16 * log2(1 + segments))." << std::endl;
+    std::cout << " --SimplifyPixels [Tolerance]: Removes contour vertices within [Tolerance] output pixels (of the final [RegionCount]x[RegionCount] tiling) of the simplified line." << std::endl;
+    std::cout << "     Speeds up indexing and rasterization of survey-grade inputs. A tolerance of 0.5 is usually indistinguishable. Disabled by default." << std::endl;
+    std::cout << " --SimplifySource [Tolerance]: As --SimplifyPixels, with the tolerance in the input coordinate units instead." << std::endl;
+    std::cout << " --LodLevels [Count]: Builds [Count] levels of detail, each simplified and indexed separately. Defaults to 1 (full detail only)." << std::endl;
+    std::cout << "     Zoomed-out views and tiles use the coarsest level within half a pixel of the input, so 4 levels speeds up the overview considerably." << std::endl;
+    std::cout << " --OutOfCore: (Headless only) Streams the contours into on-disk spatial buckets in '[OutputFolder]_buckets', then rasterizes one bucket at a time." << std::endl;
+    std::cout << "     Use for inputs that do not fit in memory. Peak memory is set by --MemoryBudget rather than the input size." << std::endl;
+    std::cout << "     With more than one bucket, each bucket's search reaches less far than an in-memory search, so tiles can differ from an in-memory export." << std::endl;
+    std::cout << " --MemoryBudget [MiB]: Specifies the approximate memory used by each out-of-core bucket. Defaults to 1024." << std::endl;
+    std::cout << " --BucketHalo [Tiles]: Specifies how many tiles of surrounding contours each out-of-core bucket or tile range includes for interpolation." << std::endl;
+    std::cout << "     Raised to the reach of the search (92 * RegionCount / RegionSize tiles) if smaller. Defaults to 1." << std::endl;
+    std::cout << " --TileRange [x0,y0,x1,y1]: (Headless only) Only rasterizes the tiles from (x0, y0) to (x1, y1) inclusive, into a possibly existing [OutputFolder]." << std::endl;
+    std::cout << "     Only contours within --BucketHalo tiles of the range are indexed, raised to the reach of the search (92 * RegionCount / RegionSize tiles) if smaller." << std::endl;
+    std::cout << "     Tiles can still differ from a single-process export with --OutOfCore, or in exact ties with --Index rtree." << std::endl;
+    std::cout << "     A [OutputFolder]/manifest_x0_y0_x1_y1.txt listing the tiles is written once done." << std::endl;
+    std::cout << " --Shard [k/N]: (Headless only) As --TileRange, with the rows of tiles split into N bands and band k (0 to N-1) rasterized." << std::endl;
+    std::cout << "     Run each shard as its own process, on one or several machines sharing the output folder." << std::endl;
+    std::cout << " --Merge: (Headless only) Validates the shard manifests in [OutputFolder] cover every tile, writing [OutputFolder]/manifest.txt if so. No inputs are needed." << std::endl;
+    std::cout << "     The tiling and tile format (such as '--OutputFormat terrain') are read from the manifests." << std::endl;
+    std::cout << " --Pyramid: (Headless only) Also builds reduced levels of tiles up to a single root tile, in [OutputFolder]/pyramid/[Zoom]/[Y]/[X].png." << std::endl;
+    std::cout << "     Zoom 0 is the root tile, with each zoom doubling the tiles per side up to the base tiles. Region counts that aren't a power of two are padded with empty tiles." << std::endl;
+    std::cout << " --PyramidFilter [mean|min|max]: Specifies how each 2x2 block of heights is reduced for the pyramid. Defaults to 'mean'." << std::endl;
+    std::cout << " --Pack: Writes the tiles (and any pyramid levels) into a single indexed [OutputFolder]/tiles.pack instead of a file per tile." << std::endl;
+    std::cout << "     Each tile is stored page-aligned with an (offset, length) directory entry, so it can be memory-mapped and read without a filesystem lookup." << std::endl;
+    std::cout << " --Numa: Pins rasterization threads to the NUMA nodes of multi-socket machines, with a copy of the contours and index on each node." << std::endl;
+    std::cout << "     Each node's threads work on their own share of each tile, reading only local memory. Uses an extra copy of the geometry per node." << std::endl;
+    std::cout << " --Serve: (Headless only) Keeps the contours and index loaded and serves elevation tiles over HTTP on localhost instead of bulk processing." << std::endl;
+    std::cout << "     GET /tile/[Zoom]/[X]/[Y].png returns tile (X, Y) of the 2^Zoom x 2^Zoom tiling of the whole region." << std::endl;
+    std::cout << "     GET /bounds/[Left]/[Top]/[Size].png returns the square area with normalized (0-1) coordinates." << std::endl;
+    std::cout << "     The size must be above 0 and at most 1, and the offsets within -1 to 1." << std::endl;
+    std::cout << " --Port [Port]: Specifies the port the tile server listens on. Defaults to 8080." << std::endl;
+    std::cout << " --CacheSize [Count]: Specifies how many encoded tiles the tile server keeps cached. Defaults to 256." << std::endl;
     std::cout << "Output Format:" << std::endl;
     std::cout << "  The rasterized, selected region is tiled into [RegionCount]x[RegionCount] images, each [RegionSize]x[RegionSize] in size." << std::endl;
     std::cout << "  These images are placed in subfolders in the [OutputFolder], where the sub folder name is the Y-coordinate and the image name the X-coordinate." << std::endl;
@@ -4,9 +4,13 @@
 
 class Settings
 {
-    bool endsWithGeoJson(std::string argument);
+    bool endsWithCaseInsensitive(std::string argument, std::string suffix);
+    bool isInputFile(std::string argument);
     bool equalsCaseInsensitive(std::string a, std::string b);
 
+    // Converts a shard to its tile range, or defaults the range to all tiles, once all arguments are known.
+    bool ResolveTileRange();
+
 public:
     Settings();
     bool ParseArguments(int argc, const char* argv[]);
@@ -17,7 +21,56 @@ public:
     int RegionCount;
     int RegionSize;
     std::string OutputFolder;
+
+    // How height tiles are encoded. Terrain tiles use the HeightCodec, with a .cth extension.
+    enum class TileFormat { Png, Terrain };
+    TileFormat OutputFormat;
+
+    // Deflate level of PNG tiles, from 0 (stored, fastest) to 9 (smallest).
+    int PngLevel;
+
     bool IsHighResolution;
-    std::vector<std::string> GeoJsonFiles;
+    bool IsQuantized;
+    bool IsRTreeIndex;
+
+    // With a positive error (in input elevation units), pixels between contours are interpolated from a coarse lattice instead of each being searched.
+    double MaxError;
+
+    // Area of interest in input coordinates, with the fraction of its size loaded around it for correct interpolation at the edges.
+    bool HasBounds;
+    double BoundsMinX, BoundsMinY, BoundsMaxX, BoundsMaxY;
+    double BoundsMargin;
+
+    bool ExportCostMaps;
+    double SimplifyTolerance;
+    bool IsSimplifyToleranceInPixels;
+    int LodLevels;
+    bool IsOutOfCore;
+    int MemoryBudget;
+    int BucketHalo;
+    bool IsNumaAware;
+    // Inclusive range of tiles this process renders (all tiles by default), set directly or from a shard of the tile rows.
+    bool HasTileRange;
+    int TileRangeMinX, TileRangeMinY, TileRangeMaxX, TileRangeMaxY;
+    int ShardIndex;
+    int ShardCount;
+    bool IsMerging;
+
+    // Returns true if the tile is within the range rendered by this process.
+    bool IsTileInRange(int regionX, int regionY) const;
+
+    // Reduced levels of tiles up to a single root tile, each pixel reduced from a 2x2 block of the level below.
+    enum class PyramidReduction { Mean, Min, Max };
+    bool IsBuildingPyramid;
+    PyramidReduction PyramidFilter;
+
+    // Writes the tiles into a single indexed [OutputFolder]/tiles.pack instead of a file per tile.
+    bool IsPacking;
+
+    bool IsServing;
+    int ServerPort;
+    int CacheSize;
+    // GeoJSON (.geojson) and shapefile (.shp) inputs.
+    std::vector<std::string> InputFiles;
 };
 
@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include "ShapefileReader.h"
+
+static_assert(sizeof(Point) == 2 * sizeof(double), "Shapefile points are read in place as Points.");
+
+ShapefileReader::ShapefileReader(std::string elevationFeature)
+    : elevationFeature(elevationFeature)
+{ }
+
+int ShapefileReader::ReadBigEndianInt(const char* data)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    return (int)(((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | (uint32_t)bytes[3]);
+}
+
+int ShapefileReader::ReadInt(const char* data)
+{
+    int32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return (int)value;
+}
+
+double ShapefileReader::ReadDouble(const char* data)
+{
+    double value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+bool ShapefileReader::IsShapefile(const std::string& file)
+{
+    const std::string extension(".shp");
+    if (file.length() < extension.length())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < extension.length(); i++)
+    {
+        if (std::tolower(file[file.length() - extension.length() + i]) != extension[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::string ShapefileReader::GetTableFileName(const std::string& file)
+{
+    // Match the case of the extension, for case-sensitive file systems.
+    bool isUpperCase = std::isupper(file[file.length() - 3]) != 0;
+    return file.substr(0, file.length() - 4) + (isUpperCase ? ".DBF" : ".dbf");
+}
+
+bool ShapefileReader::OpenShapes(const std::string& file, MappedFile& shapes) const
+{
+    if (!shapes.Open(file))
+    {
+        std::cout << "Could not open the file to read contours from: " << file << std::endl;
+        return false;
+    }
+
+    if (shapes.Size() < HeaderLength || ReadBigEndianInt(shapes.Data()) != FileCode)
+    {
+        std::cout << "The file '" << file << "' is not a shapefile." << std::endl;
+        return false;
+    }
+
+    int shapeType = ReadInt(shapes.Data() + 32);
+    if (shapeType != PolyLine && shapeType != PolyLineZ && shapeType != PolyLineM)
+    {
+        std::cout << "The shapefile '" << file << "' holds shapes of type " << shapeType << ". Only PolyLine contours (types 3, 13 and 23) are supported." << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool ShapefileReader::OpenTable(const std::string& file, Table& table) const
+{
+    std::string tableFile = GetTableFileName(file);
+    if (!table.file.Open(tableFile) || table.file.Size() < 32)
+    {
+        std::cout << "Could not open the table '" << tableFile << "' holding the elevations of the shapefile '" << file << "'." << std::endl;
+        return false;
+    }
+
+    const unsigned char* header = (const unsigned char*)table.file.Data();
+    table.recordCount = (size_t)header[4] | ((size_t)header[5] << 8) | ((size_t)header[6] << 16) | ((size_t)header[7] << 24);
+    table.headerLength = (size_t)header[8] | ((size_t)header[9] << 8);
+    table.recordLength = (size_t)header[10] | ((size_t)header[11] << 8);
+    if (table.headerLength > table.file.Size() || table.recordCount * table.recordLength > table.file.Size() - table.headerLength)
+    {
+        std::cout << "The table '" << tableFile << "' is truncated." << std::endl;
+        return false;
+    }
+
+    // Field descriptors follow the header until a terminator. Records start with a deletion flag, then each field in order.
+    size_t fieldOffset = 1;
+    for (size_t descriptor = 32; descriptor + 32 <= table.headerLength && header[descriptor] != 0x0D; descriptor += 32)
+    {
+        char name[12] = {};
+        std::memcpy(name, header + descriptor, 11);
+        size_t fieldLength = (size_t)header[descriptor + 16];
+
+        // Tools often upper-case field names, so they are matched regardless of case.
+        bool isMatch = std::strlen(name) == elevationFeature.length();
+        for (size_t i = 0; isMatch && i < elevationFeature.length(); i++)
+        {
+            isMatch = std::toupper(name[i]) == std::toupper(elevationFeature[i]);
+        }
+
+        if (isMatch)
+        {
+            table.fieldOffset = fieldOffset;
+            table.fieldLength = fieldLength;
+            table.fieldType = (char)header[descriptor + 11];
+            if (fieldOffset + fieldLength > table.recordLength)
+            {
+                std::cout << "The field '" << name << "' of the table '" << tableFile << "' is beyond the end of its records." << std::endl;
+                return false;
+            }
+
+            bool isNumeric = table.fieldType == 'N' || table.fieldType == 'F' || (table.fieldType == 'I' && fieldLength == 4) || (table.fieldType == 'O' && fieldLength == 8);
+            if (!isNumeric)
+            {
+                std::cout << "The given elevation field was not an integer or a floating point value, but of type '" << table.fieldType << "'. Only these two value types are supported." << std::endl;
+                return false;
+            }
+
+            return true;
+        }
+
+        fieldOffset += fieldLength;
+    }
+
+    std::cout << "Could not find the field '" << elevationFeature << "' in the table '" << tableFile << "'!" << std::endl;
+    return false;
+}
+
+bool ShapefileReader::ReadElevation(const Table& table, size_t record, double* elevation) const
+{
+    const char* field = table.file.Data() + table.headerLength + record * table.recordLength + table.fieldOffset;
+    if (table.fieldType == 'I')
+    {
+        *elevation = (double)ReadInt(field);
+        return true;
+    }
+    else if (table.fieldType == 'O')
+    {
+        *elevation = ReadDouble(field);
+        return true;
+    }
+
+    // Numeric fields are space-padded text.
+    char text[256];
+    std::memcpy(text, field, table.fieldLength);
+    text[table.fieldLength] = '\0';
+
+    char* parseEnd;
+    *elevation = std::strtod(text, &parseEnd);
+    if (parseEnd == text)
+    {
+        std::cout << "The elevation of record " << (record + 1) << " is blank." << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool ShapefileReader::ReadExtents(const std::string& file, ShapefileExtents* extents) const
+{
+    MappedFile shapes;
+    Table table;
+    if (!OpenShapes(file, shapes) || !OpenTable(file, table))
+    {
+        return false;
+    }
+
+    extents->minX = ReadDouble(shapes.Data() + 36);
+    extents->minY = ReadDouble(shapes.Data() + 44);
+    extents->maxX = ReadDouble(shapes.Data() + 52);
+    extents->maxY = ReadDouble(shapes.Data() + 60);
+    extents->shapeCount = (long)table.recordCount;
+
+    // Every point takes 16 bytes, so this over-estimates by the size of the record headers and part lists.
+    extents->maxPointCount = (long)((shapes.Size() - HeaderLength) / sizeof(Point));
+
+    extents->minElevation = std::numeric_limits<double>::max();
+    extents->maxElevation = std::numeric_limits<double>::lowest();
+    for (size_t i = 0; i < table.recordCount; i++)
+    {
+        double elevation;
+        if (!ReadElevation(table, i, &elevation))
+        {
+            return false;
+        }
+
+        extents->minElevation = std::min(elevation, extents->minElevation);
+        extents->maxElevation = std::max(elevation, extents->maxElevation);
+    }
+
+    return true;
+}
+
+bool ShapefileReader::Read(const std::string& file, std::function<bool(const ContourFeature&)> onFeature) const
+{
+    MappedFile shapes;
+    Table table;
+    if (!OpenShapes(file, shapes) || !OpenTable(file, table))
+    {
+        return false;
+    }
+
+    // Points are only copied here when a record leaves them unaligned.
+    std::vector<Point> alignedPoints;
+    std::vector<ContourLineSet> lineSets;
+
+    const char* data = shapes.Data();
+    size_t position = HeaderLength;
+    size_t record = 0;
+    while (position + 8 <= shapes.Size())
+    {
+        // Record lengths are in 16-bit words.
+        size_t contentLength = (size_t)ReadBigEndianInt(data + position + 4) * 2;
+        const char* content = data + position + 8;
+        if (contentLength < 4 || contentLength > shapes.Size() - position - 8)
+        {
+            std::cout << "Unable to read '" << file << "' near byte " << position << ": The record is truncated." << std::endl;
+            return false;
+        }
+
+        position += 8 + contentLength;
+        if (record >= table.recordCount)
+        {
+            std::cout << "The shapefile '" << file << "' has more shapes than its table has records." << std::endl;
+            return false;
+        }
+
+        size_t tableRecord = record++;
+        int shapeType = ReadInt(content);
+        if (shapeType == NullShape)
+        {
+            continue;
+        }
+
+        int partCount = contentLength >= 44 ? ReadInt(content + 36) : -1;
+        int pointCount = contentLength >= 44 ? ReadInt(content + 40) : -1;
+        if ((shapeType != PolyLine && shapeType != PolyLineZ && shapeType != PolyLineM) || partCount < 0 || pointCount < 0 ||
+            (size_t)partCount > (contentLength - 44) / 4 || (size_t)pointCount > (contentLength - 44 - (size_t)partCount * 4) / sizeof(Point))
+        {
+            std::cout << "Unable to read '" << file << "' near byte " << (content - data) << ": The record is not a valid PolyLine." << std::endl;
+            return false;
+        }
+
+        // Z and M values follow the points, and are skipped with the rest of the record.
+        const char* parts = content + 44;
+        const char* pointData = parts + (size_t)partCount * 4;
+        const Point* points = (const Point*)pointData;
+        if ((uintptr_t)pointData % alignof(Point) != 0)
+        {
+            alignedPoints.resize((size_t)pointCount);
+            std::memcpy(alignedPoints.data(), pointData, (size_t)pointCount * sizeof(Point));
+            points = alignedPoints.data();
+        }
+
+        lineSets.clear();
+        for (int i = 0; i < partCount; i++)
+        {
+            int start = ReadInt(parts + (size_t)i * 4);
+            int end = i + 1 < partCount ? ReadInt(parts + (size_t)(i + 1) * 4) : pointCount;
+            if (start < 0 || start > end || end > pointCount)
+            {
+                std::cout << "Unable to read '" << file << "' near byte " << (content - data) << ": The parts of the PolyLine are out of order." << std::endl;
+                return false;
+            }
+
+            ContourLineSet lineSet;
+            lineSet.points = points + start;
+            lineSet.count = (size_t)(end - start);
+            lineSets.push_back(lineSet);
+        }
+
+        ContourFeature feature;
+        if (!ReadElevation(table, tableRecord, &feature.elevation))
+        {
+            return false;
+        }
+
+        feature.lineSets = lineSets.data();
+        feature.lineSetCount = lineSets.size();
+        if (!onFeature(feature))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+#include "ContourFeature.h"
+#include "MappedFile.h"
+
+// What the headers of a shapefile say about its contents, without reading any of its shapes.
+struct ShapefileExtents
+{
+    double minX, minY, maxX, maxY;
+    double minElevation, maxElevation;
+    long shapeCount;
+
+    // An upper bound, as only the file size is known until the shapes are read.
+    long maxPointCount;
+};
+
+// Reads PolyLine contours from a memory-mapped Esri shapefile (.shp), with the elevation of each from a numeric field of the matching .dbf table.
+// Points are passed on in place from the mapped file whenever they are aligned, so reading is limited by the disk rather than parsing.
+class ShapefileReader
+{
+    // The elevation field of the .dbf table of the shapefile.
+    struct Table
+    {
+        MappedFile file;
+        size_t recordCount;
+        size_t headerLength;
+        size_t recordLength;
+        size_t fieldOffset;
+        size_t fieldLength;
+        char fieldType;
+    };
+
+    static const int FileCode = 9994;
+    static const size_t HeaderLength = 100;
+    static const int NullShape = 0;
+    static const int PolyLine = 3;
+    static const int PolyLineZ = 13;
+    static const int PolyLineM = 23;
+
+    std::string elevationFeature;
+
+    // Main file integers are big-endian, shape data little-endian.
+    static int ReadBigEndianInt(const char* data);
+    static int ReadInt(const char* data);
+    static double ReadDouble(const char* data);
+
+    // Returns the .dbf file next to the .shp file.
+    static std::string GetTableFileName(const std::string& file);
+
+    bool OpenShapes(const std::string& file, MappedFile& shapes) const;
+    bool OpenTable(const std::string& file, Table& table) const;
+
+    // Reads the elevation of a record, returning false (and printing why) if it is blank.
+    bool ReadElevation(const Table& table, size_t record, double* elevation) const;
+
+public:
+    ShapefileReader(std::string elevationFeature);
+
+    // Returns true if the file has a .shp extension.
+    static bool IsShapefile(const std::string& file);
+
+    // Reads the bounds from the .shp header and the elevation range from the .dbf table, without touching any points.
+    bool ReadExtents(const std::string& file, ShapefileExtents* extents) const;
+
+    // Reads the file, calling the callback with each PolyLine in file order. The feature is only valid during the callback.
+    // Returns false, printing why, if the file can't be read or the callback returns false.
+    bool Read(const std::string& file, std::function<bool(const ContourFeature&)> onFeature) const;
+};
@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "TileManifest.h"
+
+TileManifest::TileManifest()
+    : settings(nullptr), tileWriter(nullptr), tiles()
+{ }
+
+void TileManifest::Setup(Settings* settings, TileWriter* tileWriter)
+{
+    this->settings = settings;
+    this->tileWriter = tileWriter;
+    tiles.clear();
+}
+
+long long TileManifest::GetFileSize(std::string file)
+{
+    std::ifstream tileFile(file, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!tileFile)
+    {
+        return -1;
+    }
+
+    return (long long)tileFile.tellg();
+}
+
+const char* TileManifest::GetFormatName(Settings::TileFormat format)
+{
+    return format == Settings::TileFormat::Terrain ? "terrain" : "png";
+}
+
+void TileManifest::WriteHeader(std::ostream& manifest, int regionCount, int regionSize, Settings::TileFormat format, int minX, int minY, int maxX, int maxY)
+{
+    manifest << "RegionCount " << regionCount << std::endl;
+    manifest << "RegionSize " << regionSize << std::endl;
+    manifest << "OutputFormat " << GetFormatName(format) << std::endl;
+    manifest << "TileRange " << minX << " " << minY << " " << maxX << " " << maxY << std::endl;
+}
+
+std::string TileManifest::GetFileName() const
+{
+    std::stringstream file;
+    file << settings->OutputFolder.c_str() << "/manifest_" << settings->TileRangeMinX << "_" << settings->TileRangeMinY << "_" <<
+        settings->TileRangeMaxX << "_" << settings->TileRangeMaxY << ".txt";
+    return file.str();
+}
+
+void TileManifest::AddTile(int regionX, int regionY)
+{
+    TileEntry tile;
+    tile.regionX = regionX;
+    tile.regionY = regionY;
+    tile.fileSize = GetFileSize(tileWriter->GetTileFileName(regionX, regionY));
+    tiles.push_back(tile);
+}
+
+bool TileManifest::Write()
+{
+    std::string file = GetFileName();
+    std::string partialFile = file + ".partial";
+    {
+        std::ofstream manifest(partialFile, std::ios::out | std::ios::trunc);
+        WriteHeader(manifest, settings->RegionCount, settings->RegionSize, settings->OutputFormat, settings->TileRangeMinX, settings->TileRangeMinY, settings->TileRangeMaxX, settings->TileRangeMaxY);
+        for (const TileEntry& tile : tiles)
+        {
+            manifest << "Tile " << tile.regionX << " " << tile.regionY << " " << tile.fileSize << std::endl;
+        }
+
+        manifest << "Tiles " << tiles.size() << std::endl;
+        if (!manifest)
+        {
+            std::cout << "Unable to write the manifest " << partialFile << std::endl;
+            return false;
+        }
+    }
+
+    // Renaming does not replace an existing file on Windows.
+    std::remove(file.c_str());
+    if (std::rename(partialFile.c_str(), file.c_str()) != 0)
+    {
+        std::cout << "Unable to rename the manifest " << partialFile << " to " << file << std::endl;
+        return false;
+    }
+
+    std::cout << "Wrote the manifest " << file << " with " << tiles.size() << " tiles." << std::endl;
+    return true;
+}
+
+bool TileManifest::Read(std::string file, int* regionCount, int* regionSize, Settings::TileFormat* format, std::vector<TileEntry>& tiles)
+{
+    std::ifstream manifest(file, std::ios::in);
+    std::string key, formatName;
+    int rangeMinX, rangeMinY, rangeMaxX, rangeMaxY;
+    if (!(manifest >> key >> *regionCount) || key != "RegionCount" ||
+        !(manifest >> key >> *regionSize) || key != "RegionSize" ||
+        !(manifest >> key >> formatName) || key != "OutputFormat" ||
+        !(manifest >> key >> rangeMinX >> rangeMinY >> rangeMaxX >> rangeMaxY) || key != "TileRange")
+    {
+        return false;
+    }
+
+    if (formatName == GetFormatName(Settings::TileFormat::Terrain))
+    {
+        *format = Settings::TileFormat::Terrain;
+    }
+    else if (formatName == GetFormatName(Settings::TileFormat::Png))
+    {
+        *format = Settings::TileFormat::Png;
+    }
+    else
+    {
+        return false;
+    }
+
+    while (manifest >> key)
+    {
+        if (key == "Tiles")
+        {
+            size_t tileCount;
+            return (manifest >> tileCount) && tileCount == tiles.size();
+        }
+
+        TileEntry tile;
+        if (key != "Tile" || !(manifest >> tile.regionX >> tile.regionY >> tile.fileSize))
+        {
+            return false;
+        }
+
+        tiles.push_back(tile);
+    }
+
+    // The tile count is missing, so the manifest is incomplete.
+    return false;
+}
+
+bool TileManifest::Merge(Settings* settings)
+{
+    std::cout << "=== Merging Manifests ===" << std::endl;
+    std::vector<std::string> fileNames;
+    if (!TileWriter::ListFiles(settings->OutputFolder, fileNames))
+    {
+        std::cout << "Unable to list the files in the output folder '" << settings->OutputFolder << "'." << std::endl;
+        return false;
+    }
+
+    // The tiling and tile format are taken from the manifests, which must all agree.
+    int regionCount = 0;
+    int regionSize = 0;
+    Settings::TileFormat format = Settings::TileFormat::Png;
+    std::vector<TileEntry> allTiles;
+    int manifestCount = 0;
+    bool isValid = true;
+    for (const std::string& fileName : fileNames)
+    {
+        const std::string prefix("manifest_");
+        const std::string suffix(".txt");
+        if (fileName.length() <= prefix.length() + suffix.length() || fileName.compare(0, prefix.length(), prefix) != 0 ||
+            fileName.compare(fileName.length() - suffix.length(), suffix.length(), suffix) != 0)
+        {
+            continue;
+        }
+
+        int manifestRegionCount, manifestRegionSize;
+        Settings::TileFormat manifestFormat;
+        std::vector<TileEntry> tiles;
+        if (!Read(settings->OutputFolder + "/" + fileName, &manifestRegionCount, &manifestRegionSize, &manifestFormat, tiles))
+        {
+            std::cout << "  The manifest " << fileName << " is unreadable or incomplete." << std::endl;
+            isValid = false;
+            continue;
+        }
+
+        if (manifestCount != 0 && (manifestRegionCount != regionCount || manifestRegionSize != regionSize))
+        {
+            std::cout << "  The manifest " << fileName << " is for a " << manifestRegionCount << "x" << manifestRegionCount << " tiling of " <<
+                manifestRegionSize << " pixel tiles, not the " << regionCount << "x" << regionCount << " tiling of " << regionSize << " pixel tiles of the other manifests." << std::endl;
+            isValid = false;
+            continue;
+        }
+
+        if (manifestCount != 0 && manifestFormat != format)
+        {
+            std::cout << "  The manifest " << fileName << " is for '" << GetFormatName(manifestFormat) << "' tiles, not the '" << GetFormatName(format) << "' tiles of the other manifests." << std::endl;
+            isValid = false;
+            continue;
+        }
+
+        regionCount = manifestRegionCount;
+        regionSize = manifestRegionSize;
+        format = manifestFormat;
+        allTiles.insert(allTiles.end(), tiles.begin(), tiles.end());
+        ++manifestCount;
+    }
+
+    if (manifestCount == 0)
+    {
+        std::cout << "No complete manifests were found in '" << settings->OutputFolder << "'." << std::endl;
+        return false;
+    }
+
+    std::cout << "Read " << manifestCount << " manifests with " << allTiles.size() << " tiles." << std::endl;
+
+    // Every tile must be listed exactly once and still have the size it was written with.
+    TileWriter tileWriter;
+    Settings mergedSettings = *settings;
+    mergedSettings.RegionCount = regionCount;
+    mergedSettings.RegionSize = regionSize;
+    mergedSettings.OutputFormat = format;
+    tileWriter.Setup(&mergedSettings);
+
+    std::vector<int> tileCounts(regionCount * regionCount, 0);
+    for (const TileEntry& tile : allTiles)
+    {
+        if (tile.regionX < 0 || tile.regionY < 0 || tile.regionX >= regionCount || tile.regionY >= regionCount)
+        {
+            std::cout << "  Tile " << tile.regionX << ", " << tile.regionY << " is outside of the tiling." << std::endl;
+            isValid = false;
+            continue;
+        }
+
+        ++tileCounts[tile.regionX + tile.regionY * regionCount];
+        if (tile.fileSize <= 0 || GetFileSize(tileWriter.GetTileFileName(tile.regionX, tile.regionY)) != tile.fileSize)
+        {
+            std::cout << "  Tile " << tile.regionX << ", " << tile.regionY << " is missing or does not match its manifest." << std::endl;
+            isValid = false;
+        }
+    }
+
+    int missingTiles = 0;
+    for (int regionY = 0; regionY < regionCount; regionY++)
+    {
+        for (int regionX = 0; regionX < regionCount; regionX++)
+        {
+            int tileCount = tileCounts[regionX + regionY * regionCount];
+            if (tileCount == 0)
+            {
+                ++missingTiles;
+            }
+            else if (tileCount > 1)
+            {
+                std::cout << "  Tile " << regionX << ", " << regionY << " is in " << tileCount << " manifests. The shards overlap." << std::endl;
+                isValid = false;
+            }
+        }
+    }
+
+    if (missingTiles != 0)
+    {
+        std::cout << "  " << missingTiles << " of " << (regionCount * regionCount) << " tiles are not in any manifest." << std::endl;
+        isValid = false;
+    }
+
+    if (!isValid)
+    {
+        std::cout << "The export is incomplete or invalid." << std::endl;
+        return false;
+    }
+
+    std::sort(allTiles.begin(), allTiles.end(), [](const TileEntry& a, const TileEntry& b)
+    {
+        return a.regionY != b.regionY ? a.regionY < b.regionY : a.regionX < b.regionX;
+    });
+
+    // Record the whole job, under a name that is not itself read as a shard manifest.
+    std::ofstream manifest(settings->OutputFolder + "/manifest.txt", std::ios::out | std::ios::trunc);
+    WriteHeader(manifest, regionCount, regionSize, format, 0, 0, regionCount - 1, regionCount - 1);
+    for (const TileEntry& tile : allTiles)
+    {
+        manifest << "Tile " << tile.regionX << " " << tile.regionY << " " << tile.fileSize << std::endl;
+    }
+
+    manifest << "Tiles " << allTiles.size() << std::endl;
+    if (!manifest)
+    {
+        std::cout << "Unable to write the merged manifest." << std::endl;
+        return false;
+    }
+
+    std::cout << "All " << allTiles.size() << " tiles are present. Wrote " << settings->OutputFolder << "/manifest.txt" << std::endl;
+    return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Settings.h"
+#include "TileWriter.h"
+
+// Records the tiles written for a --TileRange or --Shard, and merges the shard records of a job to validate it is complete.
+// Manifests are text files listing the tiling, the tile format, the range and each tile with its file size, ending with the tile count.
+class TileManifest
+{
+    struct TileEntry
+    {
+        int regionX;
+        int regionY;
+        long long fileSize;
+    };
+
+    Settings* settings;
+    TileWriter* tileWriter;
+    std::vector<TileEntry> tiles;
+
+    static long long GetFileSize(std::string file);
+
+    // The --OutputFormat name of the tile format, which decides the tile file names.
+    static const char* GetFormatName(Settings::TileFormat format);
+
+    // Writes the tiling, format and range header of a manifest.
+    static void WriteHeader(std::ostream& manifest, int regionCount, int regionSize, Settings::TileFormat format, int minX, int minY, int maxX, int maxY);
+
+    // Reads a manifest, returning false if it is unreadable or was not completely written.
+    static bool Read(std::string file, int* regionCount, int* regionSize, Settings::TileFormat* format, std::vector<TileEntry>& tiles);
+
+public:
+    TileManifest();
+
+    void Setup(Settings* settings, TileWriter* tileWriter);
+
+    // Gets the file name of the manifest for the tile range of this process.
+    std::string GetFileName() const;
+
+    // Records a tile once it has been written.
+    void AddTile(int regionX, int regionY);
+
+    // Writes the manifest, replacing it in a single step so that a partial manifest is never seen as complete.
+    bool Write();
+
+    // Checks that the shard manifests in [OutputFolder] cover each tile exactly once and that every tile file is intact.
+    static bool Merge(Settings* settings);
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Layout of a tile pack, a single file holding every encoded tile. All values are little-endian.
+//   Header: magic, version, region size, payload alignment, level count, directory entry count, directory offset and file size.
+//   Levels: for each level, its zoom, tiles per side and first directory entry.
+//   Directory: an (offset, length) entry for each tile of each level, in row order. Missing tiles have a length of 0.
+//   Payloads: the encoded tiles, each starting on a multiple of the alignment. Tiles are PNG or HeightCodec encoded, identified by their own signature.
+// The magic is written last, so packs from interrupted exports are never read.
+struct TilePack
+{
+    static const size_t MagicSize = 8;
+    static const uint32_t Version = 1;
+    static const size_t HeaderSize = 48;
+    static const size_t LevelSize = 16;
+    static const size_t EntrySize = 16;
+
+    // Page-aligned payloads can be mapped or read directly (unbuffered) by the engine.
+    static const uint64_t Alignment = 4096;
+
+    static const char* Magic()
+    {
+        return "CTPACK\0\0";
+    }
+
+    static void WriteUInt32(unsigned char* data, uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            data[i] = (unsigned char)(value >> (8 * i));
+        }
+    }
+
+    static void WriteUInt64(unsigned char* data, uint64_t value)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            data[i] = (unsigned char)(value >> (8 * i));
+        }
+    }
+
+    static uint32_t ReadUInt32(const unsigned char* data)
+    {
+        uint32_t value = 0;
+        for (int i = 3; i >= 0; i--)
+        {
+            value = (value << 8) | data[i];
+        }
+
+        return value;
+    }
+
+    static uint64_t ReadUInt64(const unsigned char* data)
+    {
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; i--)
+        {
+            value = (value << 8) | data[i];
+        }
+
+        return value;
+    }
+};
+
+// A level of tiles in a pack.
+struct TilePackLevel
+{
+    int zoom;
+    int tileCount;
+    uint64_t firstEntry;
+};
+
+// An encoded tile within a mapped pack.
+struct TileSpan
+{
+    const unsigned char* data;
+    size_t size;
+};
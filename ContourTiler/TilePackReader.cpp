@@ -0,0 +1,106 @@
+#include <iostream>
+#include "TilePackReader.h"
+
+TilePackReader::TilePackReader()
+    : file(), regionSize(0), levels(), directory(nullptr)
+{ }
+
+bool TilePackReader::Open(const std::string& fileName)
+{
+    levels.clear();
+    directory = nullptr;
+    if (!file.Open(fileName))
+    {
+        std::cout << "Could not open the tile pack '" << fileName << "'." << std::endl;
+        return false;
+    }
+
+    const unsigned char* data = (const unsigned char*)file.Data();
+    if (file.Size() < TilePack::HeaderSize || std::memcmp(data, TilePack::Magic(), TilePack::MagicSize) != 0 ||
+        TilePack::ReadUInt32(data + 8) != TilePack::Version)
+    {
+        std::cout << "The file '" << fileName << "' is not a complete tile pack." << std::endl;
+        return false;
+    }
+
+    regionSize = (int)TilePack::ReadUInt32(data + 12);
+    uint64_t levelCount = TilePack::ReadUInt32(data + 20);
+    uint64_t entryCount = TilePack::ReadUInt64(data + 24);
+    uint64_t directoryOffset = TilePack::ReadUInt64(data + 32);
+    uint64_t fileSize = TilePack::ReadUInt64(data + 40);
+    // The levels are checked to fit before the directory offset is, so the remaining size can't wrap around.
+    if (fileSize > file.Size() || levelCount > (file.Size() - TilePack::HeaderSize) / TilePack::LevelSize ||
+        directoryOffset != TilePack::HeaderSize + levelCount * TilePack::LevelSize || directoryOffset > file.Size() ||
+        entryCount > (file.Size() - directoryOffset) / TilePack::EntrySize)
+    {
+        std::cout << "The tile pack '" << fileName << "' is truncated." << std::endl;
+        return false;
+    }
+
+    for (uint64_t i = 0; i < levelCount; i++)
+    {
+        const unsigned char* levelData = data + TilePack::HeaderSize + i * TilePack::LevelSize;
+        TilePackLevel level;
+        level.zoom = (int)TilePack::ReadUInt32(levelData);
+        level.tileCount = (int)TilePack::ReadUInt32(levelData + 4);
+        level.firstEntry = TilePack::ReadUInt64(levelData + 8);
+        if (level.tileCount < 0 || level.firstEntry > entryCount || (uint64_t)level.tileCount * (uint64_t)level.tileCount > entryCount - level.firstEntry)
+        {
+            std::cout << "The levels of the tile pack '" << fileName << "' are invalid." << std::endl;
+            return false;
+        }
+
+        levels.push_back(level);
+    }
+
+    // Check every tile once, so lookups need no bounds checks.
+    directory = data + directoryOffset;
+    for (uint64_t i = 0; i < entryCount; i++)
+    {
+        uint64_t offset = TilePack::ReadUInt64(directory + i * TilePack::EntrySize);
+        uint64_t length = TilePack::ReadUInt64(directory + i * TilePack::EntrySize + 8);
+        if (length != 0 && (offset > fileSize || length > fileSize - offset))
+        {
+            std::cout << "The tile pack '" << fileName << "' is truncated." << std::endl;
+            levels.clear();
+            directory = nullptr;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int TilePackReader::RegionSize() const
+{
+    return regionSize;
+}
+
+const std::vector<TilePackLevel>& TilePackReader::Levels() const
+{
+    return levels;
+}
+
+bool TilePackReader::GetTile(int zoom, int tileX, int tileY, TileSpan* tile) const
+{
+    for (const TilePackLevel& level : levels)
+    {
+        if (level.zoom != zoom || tileX < 0 || tileY < 0 || tileX >= level.tileCount || tileY >= level.tileCount)
+        {
+            continue;
+        }
+
+        const unsigned char* entry = directory + (level.firstEntry + (uint64_t)tileX + (uint64_t)tileY * (uint64_t)level.tileCount) * TilePack::EntrySize;
+        uint64_t length = TilePack::ReadUInt64(entry + 8);
+        if (length == 0)
+        {
+            return false;
+        }
+
+        tile->data = (const unsigned char*)file.Data() + TilePack::ReadUInt64(entry);
+        tile->size = (size_t)length;
+        return true;
+    }
+
+    return false;
+}
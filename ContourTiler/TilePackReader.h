@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "TilePack.h"
+
+// Reads tiles from a memory-mapped tile pack. Tiles are returned in place from the mapping, without copying.
+class TilePackReader
+{
+    MappedFile file;
+    int regionSize;
+    std::vector<TilePackLevel> levels;
+    const unsigned char* directory;
+
+public:
+    TilePackReader();
+
+    // Maps and validates the pack, printing why if it can't be read.
+    bool Open(const std::string& file);
+
+    int RegionSize() const;
+    const std::vector<TilePackLevel>& Levels() const;
+
+    // Gets an encoded tile, valid while the pack is open. Returns false if the pack doesn't have the tile.
+    bool GetTile(int zoom, int tileX, int tileY, TileSpan* tile) const;
+};
@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <iostream>
+#ifdef _WIN32
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+#include "TilePackWriter.h"
+
+static uint64_t AlignUp(uint64_t value)
+{
+    return (value + TilePack::Alignment - 1) / TilePack::Alignment * TilePack::Alignment;
+}
+
+TilePackWriter::TilePackWriter()
+    : file(), regionSize(0), levels(), entries(), nextOffset(0),
+#ifdef _WIN32
+    fileHandle(INVALID_HANDLE_VALUE)
+#else
+    fileDescriptor(-1)
+#endif
+{ }
+
+bool TilePackWriter::Create(const std::string& file, int regionSize, const std::vector<TilePackLevel>& levels)
+{
+    Close();
+    this->file = file;
+    this->regionSize = regionSize;
+    this->levels = levels;
+
+    uint64_t entryCount = 0;
+    for (TilePackLevel& level : this->levels)
+    {
+        level.firstEntry = entryCount;
+        entryCount += (uint64_t)level.tileCount * (uint64_t)level.tileCount;
+    }
+
+    Entry missingTile;
+    missingTile.offset = 0;
+    missingTile.length = 0;
+    entries.assign((size_t)entryCount, missingTile);
+    nextOffset = AlignUp(TilePack::HeaderSize + this->levels.size() * TilePack::LevelSize + entryCount * TilePack::EntrySize);
+
+#ifdef _WIN32
+    fileHandle = CreateFileA(file.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    bool isOpen = fileHandle != INVALID_HANDLE_VALUE;
+#else
+    fileDescriptor = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool isOpen = fileDescriptor >= 0;
+#endif
+    if (!isOpen)
+    {
+        std::cout << "Unable to create the tile pack '" << file << "'." << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool TilePackWriter::WriteAt(uint64_t offset, const unsigned char* data, size_t size)
+{
+    while (size != 0)
+    {
+#ifdef _WIN32
+        OVERLAPPED position = {};
+        position.Offset = (DWORD)(offset & 0xFFFFFFFF);
+        position.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD written = 0;
+        if (!WriteFile(fileHandle, data, (DWORD)std::min(size, (size_t)(1 << 30)), &written, &position) || written == 0)
+        {
+            return false;
+        }
+#else
+        ssize_t written = pwrite(fileDescriptor, data, size, (off_t)offset);
+        if (written <= 0)
+        {
+            return false;
+        }
+#endif
+        offset += (uint64_t)written;
+        data += written;
+        size -= (size_t)written;
+    }
+
+    return true;
+}
+
+bool TilePackWriter::AddTile(int zoom, int tileX, int tileY, const unsigned char* data, size_t size)
+{
+    for (const TilePackLevel& level : levels)
+    {
+        if (level.zoom != zoom || tileX < 0 || tileY < 0 || tileX >= level.tileCount || tileY >= level.tileCount)
+        {
+            continue;
+        }
+
+        // Reserving the space is the only shared step.
+        uint64_t offset = nextOffset.fetch_add(AlignUp(size));
+        if (!WriteAt(offset, data, size))
+        {
+            std::cout << "  Failure writing tile " << tileX << ", " << tileY << " at zoom " << zoom << " to the tile pack." << std::endl;
+            return false;
+        }
+
+        Entry& entry = entries[(size_t)(level.firstEntry + (uint64_t)tileX + (uint64_t)tileY * (uint64_t)level.tileCount)];
+        entry.offset = offset;
+        entry.length = size;
+        return true;
+    }
+
+    std::cout << "Tile " << tileX << ", " << tileY << " at zoom " << zoom << " is not part of the tile pack." << std::endl;
+    return false;
+}
+
+bool TilePackWriter::Finish()
+{
+    uint64_t fileSize = AlignUp(TilePack::HeaderSize + levels.size() * TilePack::LevelSize + entries.size() * TilePack::EntrySize);
+    size_t tileCount = 0;
+    for (const Entry& entry : entries)
+    {
+        fileSize = std::max(fileSize, entry.offset + entry.length);
+        tileCount += entry.length != 0 ? 1 : 0;
+    }
+
+    std::vector<unsigned char> header(TilePack::HeaderSize + levels.size() * TilePack::LevelSize + entries.size() * TilePack::EntrySize, 0);
+    TilePack::WriteUInt32(&header[8], TilePack::Version);
+    TilePack::WriteUInt32(&header[12], (uint32_t)regionSize);
+    TilePack::WriteUInt32(&header[16], (uint32_t)TilePack::Alignment);
+    TilePack::WriteUInt32(&header[20], (uint32_t)levels.size());
+    TilePack::WriteUInt64(&header[24], (uint64_t)entries.size());
+    TilePack::WriteUInt64(&header[32], TilePack::HeaderSize + levels.size() * TilePack::LevelSize);
+    TilePack::WriteUInt64(&header[40], fileSize);
+
+    unsigned char* level = &header[TilePack::HeaderSize];
+    for (const TilePackLevel& packLevel : levels)
+    {
+        TilePack::WriteUInt32(level, (uint32_t)packLevel.zoom);
+        TilePack::WriteUInt32(level + 4, (uint32_t)packLevel.tileCount);
+        TilePack::WriteUInt64(level + 8, packLevel.firstEntry);
+        level += TilePack::LevelSize;
+    }
+
+    unsigned char* entry = level;
+    for (const Entry& packEntry : entries)
+    {
+        TilePack::WriteUInt64(entry, packEntry.offset);
+        TilePack::WriteUInt64(entry + 8, packEntry.length);
+        entry += TilePack::EntrySize;
+    }
+
+    bool isWritten = WriteAt(0, &header[0], header.size()) && WriteAt(0, (const unsigned char*)TilePack::Magic(), TilePack::MagicSize);
+    Close();
+    if (!isWritten)
+    {
+        std::cout << "Unable to write the directory of the tile pack '" << file << "'." << std::endl;
+        return false;
+    }
+
+    std::cout << "Wrote the tile pack " << file << " with " << tileCount << " tiles." << std::endl;
+    return true;
+}
+
+void TilePackWriter::Close()
+{
+#ifdef _WIN32
+    if (fileHandle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(fileHandle);
+        fileHandle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (fileDescriptor >= 0)
+    {
+        close(fileDescriptor);
+        fileDescriptor = -1;
+    }
+#endif
+}
+
+TilePackWriter::~TilePackWriter()
+{
+    Close();
+}
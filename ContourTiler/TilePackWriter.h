@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "TilePack.h"
+
+// Writes encoded tiles into a tile pack. Tiles may be added from several threads at once:
+// each reserves its space with an atomic offset and writes at that offset without a shared file position, so no writer waits on another.
+class TilePackWriter
+{
+    struct Entry
+    {
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    std::string file;
+    int regionSize;
+    std::vector<TilePackLevel> levels;
+
+    // Each tile only writes its own entry.
+    std::vector<Entry> entries;
+    std::atomic<uint64_t> nextOffset;
+
+#ifdef _WIN32
+    void* fileHandle;
+#else
+    int fileDescriptor;
+#endif
+
+    // Writes at an offset without moving (or depending on) the file position.
+    bool WriteAt(uint64_t offset, const unsigned char* data, size_t size);
+    void Close();
+
+    TilePackWriter(const TilePackWriter&) = delete;
+    TilePackWriter& operator=(const TilePackWriter&) = delete;
+
+public:
+    TilePackWriter();
+
+    // Creates the pack for the levels (with zoom and tile counts set), replacing any existing file.
+    bool Create(const std::string& file, int regionSize, const std::vector<TilePackLevel>& levels);
+
+    // Adds an encoded tile. Safe to call from several threads at once, with each tile added only once.
+    bool AddTile(int zoom, int tileX, int tileY, const unsigned char* data, size_t size);
+
+    // Writes the directory and header, completing the pack.
+    bool Finish();
+
+    ~TilePackWriter();
+};
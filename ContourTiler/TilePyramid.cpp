@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <iostream>
+#include "TilePyramid.h"
+
+// Reduces each 2x2 block of the child into the corresponding pixel of the parent's quadrant.
+template <typename Reducer>
+static void ReduceBlocks(const uint16_t* childHeights, uint16_t* quadrant, int size, Reducer reduce)
+{
+    int half = size / 2;
+    for (int y = 0; y < half; y++)
+    {
+        const uint16_t* topRow = childHeights + (2 * y) * size;
+        const uint16_t* bottomRow = topRow + size;
+        uint16_t* parentRow = quadrant + y * size;
+        for (int x = 0; x < half; x++)
+        {
+            parentRow[x] = reduce(topRow[2 * x], topRow[2 * x + 1], bottomRow[2 * x], bottomRow[2 * x + 1]);
+        }
+    }
+}
+
+TilePyramid::TilePyramid()
+    : settings(nullptr), tileWriter(nullptr), levels(), baseHeights()
+{ }
+
+bool TilePyramid::Setup(Settings* settings, TileWriter* tileWriter)
+{
+    this->settings = settings;
+    this->tileWriter = tileWriter;
+    levels.clear();
+
+    // Tilings that aren't a power of two are treated as the top-left of the next power of two, with the missing tiles left empty (0).
+    int baseZoom = TileWriter::GetBaseZoom(settings->RegionCount);
+
+    int tileCount = settings->RegionCount;
+    for (int zoom = baseZoom - 1; zoom >= 0; zoom--)
+    {
+        Level level;
+        level.zoom = zoom;
+        level.tileCount = (tileCount + 1) / 2;
+        tileCount = level.tileCount;
+        if (!tileWriter->CreatePyramidFolders(level.zoom, level.tileCount))
+        {
+            return false;
+        }
+
+        levels.push_back(level);
+    }
+
+    std::cout << "Building " << levels.size() << " pyramid levels above the base tiles (zoom " << baseZoom << ")." << std::endl;
+    return true;
+}
+
+void TilePyramid::Reduce(const uint16_t* childHeights, int childX, int childY, uint16_t* parentHeights) const
+{
+    int size = settings->RegionSize;
+    uint16_t* quadrant = parentHeights + (childX % 2) * (size / 2) + (childY % 2) * (size / 2) * size;
+    switch (settings->PyramidFilter)
+    {
+    case Settings::PyramidReduction::Min:
+        ReduceBlocks(childHeights, quadrant, size, [](uint16_t a, uint16_t b, uint16_t c, uint16_t d)
+        {
+            return std::min(std::min(a, b), std::min(c, d));
+        });
+        break;
+    case Settings::PyramidReduction::Max:
+        ReduceBlocks(childHeights, quadrant, size, [](uint16_t a, uint16_t b, uint16_t c, uint16_t d)
+        {
+            return std::max(std::max(a, b), std::max(c, d));
+        });
+        break;
+    default:
+        // Rounded to the nearest height.
+        ReduceBlocks(childHeights, quadrant, size, [](uint16_t a, uint16_t b, uint16_t c, uint16_t d)
+        {
+            return (uint16_t)(((uint32_t)a + b + c + d + 2) / 4);
+        });
+        break;
+    }
+}
+
+bool TilePyramid::AddToLevel(size_t levelIndex, int childX, int childY, const uint16_t* childHeights)
+{
+    Level& level = levels[levelIndex];
+    int childCount = levelIndex == 0 ? settings->RegionCount : levels[levelIndex - 1].tileCount;
+    int parentX = childX / 2;
+    int parentY = childY / 2;
+
+    int key = parentX + parentY * level.tileCount;
+    auto pendingTile = level.pendingTiles.find(key);
+    if (pendingTile == level.pendingTiles.end())
+    {
+        PendingTile tile;
+        tile.heights.assign(settings->RegionSize * settings->RegionSize, 0);
+        tile.childrenAdded = 0;
+        pendingTile = level.pendingTiles.emplace(key, std::move(tile)).first;
+    }
+
+    Reduce(childHeights, childX, childY, &pendingTile->second.heights[0]);
+    ++pendingTile->second.childrenAdded;
+
+    // Parents on the right and bottom edges of tilings that aren't a power of two have fewer children.
+    int expectedChildren = (std::min(2 * parentX + 2, childCount) - 2 * parentX) * (std::min(2 * parentY + 2, childCount) - 2 * parentY);
+    if (pendingTile->second.childrenAdded < expectedChildren)
+    {
+        return true;
+    }
+
+    std::vector<uint16_t> parentHeights = std::move(pendingTile->second.heights);
+    level.pendingTiles.erase(pendingTile);
+    if (!tileWriter->WritePyramidTile(level.zoom, parentX, parentY, &parentHeights[0]))
+    {
+        return false;
+    }
+
+    return levelIndex + 1 == levels.size() || AddToLevel(levelIndex + 1, parentX, parentY, &parentHeights[0]);
+}
+
+bool TilePyramid::AddTile(int regionX, int regionY, const double* rasterStore)
+{
+    if (levels.empty())
+    {
+        return true;
+    }
+
+    baseHeights.resize(settings->RegionSize * settings->RegionSize);
+    tileWriter->ToHeights(rasterStore, &baseHeights[0]);
+    return AddToLevel(0, regionX, regionY, &baseHeights[0]);
+}
+
+bool TilePyramid::Finish()
+{
+    size_t incompleteTiles = 0;
+    for (const Level& level : levels)
+    {
+        incompleteTiles += level.pendingTiles.size();
+    }
+
+    if (incompleteTiles != 0)
+    {
+        std::cout << incompleteTiles << " pyramid tiles are missing some of their children and were not written." << std::endl;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "Settings.h"
+#include "TileWriter.h"
+
+// Builds the reduced levels above the base tiles, halving the resolution at each level until a single root tile covers everything.
+// Each tile is reduced into its parent as soon as it is written, and parents are written (and freed) once all their children are in,
+// so exporting tiles in rows only holds about a row of parent tiles per level.
+class TilePyramid
+{
+    // A parent tile waiting for its children.
+    struct PendingTile
+    {
+        std::vector<uint16_t> heights;
+        int childrenAdded;
+    };
+
+    struct Level
+    {
+        // Zoom 0 is the root tile, with each higher zoom doubling the tiles per side.
+        int zoom;
+        int tileCount;
+
+        // Tiles with some but not all children, by [X] + [Y] * [TileCount].
+        std::map<int, PendingTile> pendingTiles;
+    };
+
+    Settings* settings;
+    TileWriter* tileWriter;
+
+    // The levels above the base tiles, from the highest zoom down to the root.
+    std::vector<Level> levels;
+    std::vector<uint16_t> baseHeights;
+
+    // Reduces each 2x2 block of the child into a quarter of the parent.
+    void Reduce(const uint16_t* childHeights, int childX, int childY, uint16_t* parentHeights) const;
+
+    // Adds a child tile (of the level below) to its parent in the level, writing the parent if it is then complete.
+    bool AddToLevel(size_t levelIndex, int childX, int childY, const uint16_t* childHeights);
+
+public:
+    TilePyramid();
+
+    // Plans the levels for the tiling and creates their folders.
+    bool Setup(Settings* settings, TileWriter* tileWriter);
+
+    // Adds a base tile that has just been written.
+    bool AddTile(int regionX, int regionY, const double* rasterStore);
+
+    // Returns false if any parent tile is still missing children.
+    bool Finish();
+};
@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma comment(lib, "Ws2_32")
+    typedef SOCKET SocketHandle;
+    #define CloseSocket closesocket
+    #define SendFlags 0
+#else
+    #include <arpa/inet.h>
+    #include <netinet/in.h>
+    #include <sys/socket.h>
+    #include <sys/time.h>
+    #include <unistd.h>
+    typedef int SocketHandle;
+    #define INVALID_SOCKET (-1)
+    #define CloseSocket close
+    #define SendFlags MSG_NOSIGNAL
+#endif
+#include "TileServer.h"
+
+TileServer::TileServer(Rasterizer* rasterizer)
+    : settings(nullptr), rasterizer(rasterizer), tileWriter(), workerPool()
+{ }
+
+TileServer::EncodedTile TileServer::GetCachedTile(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto cachedTile = cache.find(path);
+    if (cachedTile == cache.end())
+    {
+        return EncodedTile();
+    }
+
+    // Move to the most-recently-used position.
+    cacheOrder.splice(cacheOrder.begin(), cacheOrder, cachedTile->second.second);
+    return cachedTile->second.first;
+}
+
+void TileServer::CacheTile(const std::string& path, EncodedTile tile)
+{
+    if (settings->CacheSize == 0)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (cache.find(path) != cache.end())
+    {
+        // Another connection rendered the same tile concurrently.
+        return;
+    }
+
+    cacheOrder.push_front(path);
+    cache[path] = std::make_pair(tile, cacheOrder.begin());
+    while ((int)cache.size() > settings->CacheSize)
+    {
+        cache.erase(cacheOrder.back());
+        cacheOrder.pop_back();
+    }
+}
+
+bool TileServer::ParseTilePath(const std::string& path, double* leftOffset, double* topOffset, double* effectiveSize)
+{
+    // %n is only set once the whole pattern, including the extension, has matched. Anything after the extension is rejected.
+    int zoom, x, y;
+    int consumed = -1;
+    if (std::sscanf(path.c_str(), "/tile/%d/%d/%d.png%n", &zoom, &x, &y, &consumed) == 3 && consumed == (int)path.length())
+    {
+        if (zoom < 0 || zoom > 30)
+        {
+            return false;
+        }
+
+        int tileCount = 1 << zoom;
+        if (x < 0 || y < 0 || x >= tileCount || y >= tileCount)
+        {
+            return false;
+        }
+
+        *effectiveSize = 1.0 / (double)tileCount;
+        *leftOffset = (double)x * *effectiveSize;
+        *topOffset = (double)y * *effectiveSize;
+        return true;
+    }
+
+    // %lf would read the '.' of a size like '1.png', so the extension is removed first.
+    const std::string extension = ".png";
+    if (path.length() <= extension.length() || path.compare(path.length() - extension.length(), extension.length(), extension) != 0)
+    {
+        return false;
+    }
+
+    std::string area = path.substr(0, path.length() - extension.length());
+    consumed = -1;
+    if (std::sscanf(area.c_str(), "/bounds/%lf/%lf/%lf%n", leftOffset, topOffset, effectiveSize, &consumed) == 3 && consumed == (int)area.length())
+    {
+        // %lf also reads 'nan', 'inf' and out of range values, none of which can be rasterized.
+        if (!std::isfinite(*leftOffset) || !std::isfinite(*topOffset) || !std::isfinite(*effectiveSize))
+        {
+            return false;
+        }
+
+        // The area can extend past the tiled region (which is empty there), but not be larger than it.
+        return *effectiveSize > 0 && *effectiveSize <= 1.0 &&
+            *leftOffset >= -1.0 && *leftOffset <= 1.0 && *topOffset >= -1.0 && *topOffset <= 1.0;
+    }
+
+    return false;
+}
+
+TileServer::EncodedTile TileServer::RenderTile(double leftOffset, double topOffset, double effectiveSize)
+{
+    std::vector<double> rasterStore(settings->RegionSize * settings->RegionSize);
+    workerPool->ParallelFor(settings->RegionSize, [&](int column)
+    {
+        rasterizer->ComputeColumn(leftOffset, topOffset, effectiveSize, column, &rasterStore[0], nullptr);
+    });
+
+    EncodedTile tile = std::make_shared<std::vector<unsigned char>>();
+    if (!tileWriter.EncodeHeightTile(&rasterStore[0], *tile))
+    {
+        return EncodedTile();
+    }
+
+    return tile;
+}
+
+// Sends the whole buffer, returning false if the client disconnected.
+static bool SendAll(SocketHandle socket, const char* data, size_t length)
+{
+    while (length > 0)
+    {
+        int sent = (int)send(socket, data, (int)std::min(length, (size_t)(1 << 20)), SendFlags);
+        if (sent <= 0)
+        {
+            return false;
+        }
+
+        data += sent;
+        length -= sent;
+    }
+
+    return true;
+}
+
+// Makes reads and writes on the socket fail once they have waited the timeout.
+static void SetTimeouts(SocketHandle socket, int timeoutSeconds)
+{
+#ifdef _WIN32
+    DWORD timeout = (DWORD)timeoutSeconds * 1000;
+#else
+    timeval timeout;
+    timeout.tv_sec = timeoutSeconds;
+    timeout.tv_usec = 0;
+#endif
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+    setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+}
+
+static void SendResponse(SocketHandle socket, const char* status, const char* contentType, const char* body, size_t bodyLength)
+{
+    std::stringstream header;
+    header << "HTTP/1.1 " << status << "\r\n";
+    header << "Content-Type: " << contentType << "\r\n";
+    header << "Content-Length: " << bodyLength << "\r\n";
+    header << "Connection: close\r\n\r\n";
+
+    std::string headerText = header.str();
+    if (SendAll(socket, headerText.c_str(), headerText.length()))
+    {
+        SendAll(socket, body, bodyLength);
+    }
+}
+
+static void SendError(SocketHandle socket, const char* status)
+{
+    SendResponse(socket, status, "text/plain", status, std::strlen(status));
+}
+
+void TileServer::HandleConnection(std::intptr_t connection)
+{
+    SocketHandle socket = (SocketHandle)connection;
+    SetTimeouts(socket, ConnectionTimeoutSeconds);
+
+    // Read until the end of the request headers. Tile requests have no body.
+    std::string request;
+    char buffer[4096];
+    while (request.find("\r\n\r\n") == std::string::npos && request.length() < 16384)
+    {
+        int received = (int)recv(socket, buffer, sizeof(buffer), 0);
+        if (received <= 0)
+        {
+            break;
+        }
+
+        request.append(buffer, received);
+    }
+
+    // The client closed the connection or timed out before sending a request line.
+    if (request.find("\r\n") == std::string::npos)
+    {
+        CloseSocket(socket);
+        return;
+    }
+
+    std::istringstream requestLine(request.substr(0, request.find("\r\n")));
+    std::string method, path;
+    requestLine >> method >> path;
+
+    auto startTime = std::chrono::steady_clock::now();
+    double leftOffset, topOffset, effectiveSize;
+    if (method != "GET")
+    {
+        SendError(socket, "405 Method Not Allowed");
+    }
+    else if (!ParseTilePath(path, &leftOffset, &topOffset, &effectiveSize))
+    {
+        SendError(socket, "404 Not Found");
+    }
+    else
+    {
+        bool wasCached = true;
+        EncodedTile tile = GetCachedTile(path);
+        if (!tile)
+        {
+            wasCached = false;
+            tile = RenderTile(leftOffset, topOffset, effectiveSize);
+            if (tile)
+            {
+                CacheTile(path, tile);
+            }
+        }
+
+        if (tile)
+        {
+            SendResponse(socket, "200 OK", "image/png", (const char*)&(*tile)[0], tile->size());
+        }
+        else
+        {
+            SendError(socket, "500 Internal Server Error");
+        }
+
+        std::chrono::duration<double> requestTime = std::chrono::steady_clock::now() - startTime;
+        std::lock_guard<std::mutex> lock(logMutex);
+        std::cout << "Served " << path << " in " << requestTime.count() << " s" << (wasCached ? " (cached)." : ".") << std::endl;
+    }
+
+    CloseSocket(socket);
+}
+
+void TileServer::RunConnectionThread()
+{
+    while (true)
+    {
+        std::intptr_t connection;
+        {
+            std::unique_lock<std::mutex> lock(connectionMutex);
+            connectionAvailable.wait(lock, [this] { return !connections.empty(); });
+            connection = connections.front();
+            connections.pop();
+        }
+
+        HandleConnection(connection);
+    }
+}
+
+bool TileServer::Run(Settings* settings)
+{
+    this->settings = settings;
+    tileWriter.Setup(settings);
+
+    // Connection threads encode tiles concurrently while the pool rasterizes others, so each tile is encoded on its own thread.
+    tileWriter.SetEncodeThreadCount(1);
+    workerPool.reset(new WorkerPool(0, settings->IsNumaAware));
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+    {
+        std::cout << "Unable to initialize Winsock!" << std::endl;
+        return false;
+    }
+#endif
+
+    SocketHandle listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener == INVALID_SOCKET)
+    {
+        std::cout << "Unable to create the server socket!" << std::endl;
+        return false;
+    }
+
+    int reuseAddress = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuseAddress, sizeof(reuseAddress));
+
+    // Only listen locally, this server has no authentication.
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons((unsigned short)settings->ServerPort);
+    if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0)
+    {
+        std::cout << "Unable to listen on port " << settings->ServerPort << "!" << std::endl;
+        CloseSocket(listener);
+        return false;
+    }
+
+    for (int i = 0; i < ConnectionThreadCount; i++)
+    {
+        std::thread(&TileServer::RunConnectionThread, this).detach();
+    }
+
+    std::cout << "Serving tiles on http://127.0.0.1:" << settings->ServerPort << "/ with " << workerPool->ThreadCount() << " rasterization threads." << std::endl;
+    while (true)
+    {
+        SocketHandle connection = accept(listener, nullptr, nullptr);
+        if (connection == INVALID_SOCKET)
+        {
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(connectionMutex);
+            connections.push((std::intptr_t)connection);
+        }
+
+        connectionAvailable.notify_one();
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+#include "Rasterizer.h"
+#include "Settings.h"
+#include "TileWriter.h"
+#include "WorkerPool.h"
+
+// Serves elevation tiles over HTTP on localhost, keeping the contours and index resident between requests.
+class TileServer
+{
+    typedef std::shared_ptr<std::vector<unsigned char>> EncodedTile;
+
+    // Threads that parse requests and wait on rasterization, which itself runs on the worker pool.
+    static const int ConnectionThreadCount = 4;
+
+    // Connections that don't send or receive for this long are closed, so idle clients can't hold the connection threads.
+    static const int ConnectionTimeoutSeconds = 10;
+
+    Settings* settings;
+    Rasterizer* rasterizer;
+    TileWriter tileWriter;
+    std::unique_ptr<WorkerPool> workerPool;
+
+    // Least-recently-used cache of encoded tiles, keyed by the request path.
+    std::mutex cacheMutex;
+    std::list<std::string> cacheOrder;
+    std::map<std::string, std::pair<EncodedTile, std::list<std::string>::iterator>> cache;
+
+    // Accepted connections waiting for a connection thread.
+    std::mutex connectionMutex;
+    std::condition_variable connectionAvailable;
+    std::queue<std::intptr_t> connections;
+
+    std::mutex logMutex;
+
+    EncodedTile GetCachedTile(const std::string& path);
+    void CacheTile(const std::string& path, EncodedTile tile);
+
+    // Parses a tile request path into normalized bounds. Returns false if the path isn't a valid tile request.
+    static bool ParseTilePath(const std::string& path, double* leftOffset, double* topOffset, double* effectiveSize);
+
+    // Rasterizes and encodes the area, splitting columns across the shared worker pool.
+    EncodedTile RenderTile(double leftOffset, double topOffset, double effectiveSize);
+
+    void HandleConnection(std::intptr_t connection);
+    void RunConnectionThread();
+
+public:
+    TileServer(Rasterizer* rasterizer);
+
+    // Listens for and serves requests until the process is stopped. Returns false if the server could not start.
+    bool Run(Settings* settings);
+};
@@ -0,0 +1,382 @@
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#ifdef _WIN32
+    #include <direct.h>
+    #include <io.h>
+#else
+    #include <dirent.h>
+    #include <sys/stat.h>
+    #include <sys/types.h>
+    #include <unistd.h>
+#endif
+#include "HeightCodec.h"
+#include "PngWriter.h"
+#include "TilePackReader.h"
+#include "TileWriter.h"
+
+TileWriter::TileWriter()
+    : settings(nullptr), packWriter(), encodeThreadCount(0)
+{ }
+
+void TileWriter::Setup(Settings* settings)
+{
+    this->settings = settings;
+}
+
+void TileWriter::SetEncodeThreadCount(int threadCount)
+{
+    encodeThreadCount = threadCount;
+}
+
+int TileWriter::GetBaseZoom(int regionCount)
+{
+    int baseZoom = 0;
+    while ((1 << baseZoom) < regionCount)
+    {
+        ++baseZoom;
+    }
+
+    return baseZoom;
+}
+
+std::string TileWriter::GetPackFileName() const
+{
+    return settings->OutputFolder + "/tiles.pack";
+}
+
+bool TileWriter::CreateFolder(std::string folder, bool allowExisting)
+{
+#ifdef _WIN32
+    int result = _mkdir(folder.c_str());
+#else
+    int result = mkdir(folder.c_str(), 0755);
+#endif
+    if (result != 0 && allowExisting && errno == EEXIST)
+    {
+        return true;
+    }
+
+    if (result != 0)
+    {
+        std::cout << "Unable to create directory '" << folder.c_str() << "'. This application will not overwrite existing folders or may not have permission." << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool TileWriter::RemoveFolder(std::string folder)
+{
+#ifdef _WIN32
+    return _rmdir(folder.c_str()) == 0;
+#else
+    return rmdir(folder.c_str()) == 0;
+#endif
+}
+
+bool TileWriter::ListFiles(std::string folder, std::vector<std::string>& fileNames)
+{
+#ifdef _WIN32
+    _finddata_t fileData;
+    intptr_t handle = _findfirst((folder + "/*").c_str(), &fileData);
+    if (handle == -1)
+    {
+        return false;
+    }
+
+    do
+    {
+        if ((fileData.attrib & _A_SUBDIR) == 0)
+        {
+            fileNames.push_back(fileData.name);
+        }
+    } while (_findnext(handle, &fileData) == 0);
+
+    _findclose(handle);
+#else
+    DIR* directory = opendir(folder.c_str());
+    if (directory == nullptr)
+    {
+        return false;
+    }
+
+    while (dirent* entry = readdir(directory))
+    {
+        std::string fileName(entry->d_name);
+        struct stat fileStat;
+        if (stat((folder + "/" + fileName).c_str(), &fileStat) == 0 && S_ISREG(fileStat.st_mode))
+        {
+            fileNames.push_back(fileName);
+        }
+    }
+
+    closedir(directory);
+#endif
+    return true;
+}
+
+bool TileWriter::CreateOutputFolder()
+{
+    // Shards of a larger job write into the same output folder.
+    if (!CreateFolder(settings->OutputFolder, settings->HasTileRange))
+    {
+        return false;
+    }
+
+    if (!settings->IsPacking)
+    {
+        return true;
+    }
+
+    // The base tiles, and the reduced levels above them if building a pyramid.
+    std::vector<TilePackLevel> levels;
+    int baseZoom = GetBaseZoom(settings->RegionCount);
+    for (int zoom = settings->IsBuildingPyramid ? 0 : baseZoom; zoom <= baseZoom; zoom++)
+    {
+        TilePackLevel level;
+        level.zoom = zoom;
+        level.tileCount = (settings->RegionCount + (1 << (baseZoom - zoom)) - 1) >> (baseZoom - zoom);
+        level.firstEntry = 0;
+        levels.push_back(level);
+    }
+
+    packWriter.reset(new TilePackWriter());
+    return packWriter->Create(GetPackFileName(), settings->RegionSize, levels);
+}
+
+bool TileWriter::Finish()
+{
+    if (!packWriter)
+    {
+        return true;
+    }
+
+    bool isFinished = packWriter->Finish();
+    packWriter.reset();
+
+    // Check the pack reads back.
+    TilePackReader packReader;
+    return isFinished && packReader.Open(GetPackFileName());
+}
+
+bool TileWriter::CreateRowFolder(int regionY)
+{
+    // Packed tiles don't need folders, unless cost maps are also written.
+    if (settings->IsPacking && !settings->ExportCostMaps)
+    {
+        return true;
+    }
+
+    std::stringstream folder;
+    folder << settings->OutputFolder.c_str() << "/" << regionY;
+    if (!CreateFolder(folder.str(), settings->HasTileRange))
+    {
+        return false;
+    }
+
+    std::cout << "Making directory " << folder.str().c_str() << std::endl;
+    return true;
+}
+
+const char* TileWriter::GetHeightExtension() const
+{
+    return settings->OutputFormat == Settings::TileFormat::Terrain ? ".cth" : ".png";
+}
+
+std::string TileWriter::GetTileFileName(int regionX, int regionY) const
+{
+    std::stringstream file;
+    file << settings->OutputFolder.c_str() << "/" << regionY << "/" << regionX << GetHeightExtension();
+    return file.str();
+}
+
+std::string TileWriter::GetCostTileFileName(int regionX, int regionY) const
+{
+    std::stringstream file;
+    file << settings->OutputFolder.c_str() << "/" << regionY << "/" << regionX << "_cost.png";
+    return file.str();
+}
+
+bool TileWriter::CreatePyramidFolders(int zoom, int tileCount)
+{
+    if (settings->IsPacking)
+    {
+        return true;
+    }
+
+    std::stringstream folder;
+    folder << settings->OutputFolder.c_str() << "/pyramid";
+    if (!CreateFolder(folder.str(), true))
+    {
+        return false;
+    }
+
+    folder << "/" << zoom;
+    if (!CreateFolder(folder.str()))
+    {
+        return false;
+    }
+
+    for (int tileY = 0; tileY < tileCount; tileY++)
+    {
+        std::stringstream rowFolder;
+        rowFolder << folder.str() << "/" << tileY;
+        if (!CreateFolder(rowFolder.str()))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::string TileWriter::GetPyramidTileFileName(int zoom, int tileX, int tileY) const
+{
+    std::stringstream file;
+    file << settings->OutputFolder.c_str() << "/pyramid/" << zoom << "/" << tileY << "/" << tileX << GetHeightExtension();
+    return file.str();
+}
+
+void TileWriter::ToHeights(const double* rasterStore, uint16_t* heights) const
+{
+    for (int i = 0; i < settings->RegionSize * settings->RegionSize; i++)
+    {
+        heights[i] = (uint16_t)std::min((int)(rasterStore[i] * (65536)), 65535);
+    }
+}
+
+void TileWriter::FillHeightPixels(const uint16_t* heights, unsigned char* data) const
+{
+    for (int i = 0; i < settings->RegionSize * settings->RegionSize; i++)
+    {
+        // RGBA order
+        // RED == lower 8 bits.
+        // GREEN == upper 8 bits.
+        data[i * 4] = (unsigned char)(heights[i] & 0x00FF);
+        data[i * 4 + 1] = (unsigned char)((heights[i] & 0xFF00) >> 8);
+        data[i * 4 + 2] = 255;
+        data[i * 4 + 3] = 255;
+    }
+}
+
+bool TileWriter::WriteHeightFile(std::string file, const uint16_t* heights) const
+{
+    if (settings->OutputFormat == Settings::TileFormat::Terrain)
+    {
+        std::vector<unsigned char> encodedTile;
+        HeightCodec::Encode(heights, settings->RegionSize, settings->RegionSize, encodedTile);
+
+        std::cout << file.c_str() << std::endl;
+        std::ofstream tileFile(file, std::ios::out | std::ios::binary);
+        tileFile.write((const char*)&encodedTile[0], encodedTile.size());
+        return tileFile.good();
+    }
+
+    unsigned char* data = new unsigned char[settings->RegionSize * settings->RegionSize * 4];
+    FillHeightPixels(heights, data);
+
+    const int RGBA = 4;
+    std::cout << file.c_str() << std::endl;
+    bool isWritten = PngWriter::Write(file, &data[0], settings->RegionSize, settings->RegionSize, RGBA, settings->PngLevel, encodeThreadCount);
+    delete[] data;
+    return isWritten;
+}
+
+bool TileWriter::WriteHeightTile(int regionX, int regionY, const double* rasterStore)
+{
+    std::vector<uint16_t> heights(settings->RegionSize * settings->RegionSize);
+    ToHeights(rasterStore, &heights[0]);
+    if (packWriter)
+    {
+        std::vector<unsigned char> encodedTile;
+        return EncodeHeights(&heights[0], encodedTile) &&
+            packWriter->AddTile(GetBaseZoom(settings->RegionCount), regionX, regionY, &encodedTile[0], encodedTile.size());
+    }
+
+    if (!WriteHeightFile(GetTileFileName(regionX, regionY), &heights[0]))
+    {
+        std::cout << "  Failure writing to file for raster " << regionX << ", " << regionY << std::endl;
+        return false;
+    }
+
+    std::cout << "Wrote the file " << regionX << ", " << regionY << std::endl;
+    return true;
+}
+
+bool TileWriter::WritePyramidTile(int zoom, int tileX, int tileY, const uint16_t* heights)
+{
+    if (packWriter)
+    {
+        std::vector<unsigned char> encodedTile;
+        return EncodeHeights(heights, encodedTile) && packWriter->AddTile(zoom, tileX, tileY, &encodedTile[0], encodedTile.size());
+    }
+
+    if (!WriteHeightFile(GetPyramidTileFileName(zoom, tileX, tileY), heights))
+    {
+        std::cout << "  Failure writing to file for pyramid tile " << tileX << ", " << tileY << " at zoom " << zoom << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool TileWriter::EncodeHeightTile(const double* rasterStore, std::vector<unsigned char>& encodedTile) const
+{
+    std::vector<uint16_t> heights(settings->RegionSize * settings->RegionSize);
+    ToHeights(rasterStore, &heights[0]);
+    return EncodePng(&heights[0], encodedTile);
+}
+
+bool TileWriter::EncodeHeights(const uint16_t* heights, std::vector<unsigned char>& encodedTile) const
+{
+    if (settings->OutputFormat == Settings::TileFormat::Terrain)
+    {
+        HeightCodec::Encode(heights, settings->RegionSize, settings->RegionSize, encodedTile);
+        return true;
+    }
+
+    return EncodePng(heights, encodedTile);
+}
+
+bool TileWriter::EncodePng(const uint16_t* heights, std::vector<unsigned char>& encodedTile) const
+{
+    unsigned char* data = new unsigned char[settings->RegionSize * settings->RegionSize * 4];
+    FillHeightPixels(heights, data);
+
+    const int RGBA = 4;
+    PngWriter::Encode(&data[0], settings->RegionSize, settings->RegionSize, RGBA, settings->PngLevel, encodedTile, encodeThreadCount);
+    delete[] data;
+    return true;
+}
+
+bool TileWriter::WriteCostTile(int regionX, int regionY, const RasterCost* costStore)
+{
+    std::string file = GetCostTileFileName(regionX, regionY);
+
+    unsigned char* data = new unsigned char[settings->RegionSize * settings->RegionSize * 4];
+    for (int i = 0; i < settings->RegionSize * settings->RegionSize; i++)
+    {
+        // RGBA order, see Settings::OutputUsage for the channel meanings.
+        const RasterCost& cost = costStore[i];
+        data[i * 4] = (unsigned char)std::min(cost.ringsVisited, 255);
+        data[i * 4 + 1] = (unsigned char)std::min(cost.sectorsFilled * 25, 255);
+        data[i * 4 + 2] = (unsigned char)std::min((int)(16.0 * std::log2(1.0 + (double)cost.segmentsTested)), 255);
+        data[i * 4 + 3] = 255;
+    }
+
+    const int RGBA = 4;
+    bool isWritten = PngWriter::Write(file, &data[0], settings->RegionSize, settings->RegionSize, RGBA, settings->PngLevel, encodeThreadCount);
+    delete[] data;
+
+    if (!isWritten)
+    {
+        std::cout << "  Failed writing the cost map " << file.c_str() << std::endl;
+        return false;
+    }
+
+    return true;
+}
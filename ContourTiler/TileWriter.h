@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "RasterCost.h"
+#include "Settings.h"
+#include "TilePackWriter.h"
+
+// Writes rasterized regions out to the [OutputFolder]/[Y]/[X].png (or .cth) tile layout, or with --Pack into a single tile pack.
+class TileWriter
+{
+    Settings* settings;
+    std::unique_ptr<TilePackWriter> packWriter;
+
+    // Threads each PNG is deflated on, or one per core if zero.
+    int encodeThreadCount;
+
+    // Converts 16-bit heights into RGBA pixels with the height in the red (LSB) and green (MSB) channels.
+    void FillHeightPixels(const uint16_t* heights, unsigned char* data) const;
+
+    // The extension of height tiles in the output format.
+    const char* GetHeightExtension() const;
+
+    bool WriteHeightFile(std::string file, const uint16_t* heights) const;
+    bool EncodePng(const uint16_t* heights, std::vector<unsigned char>& encodedTile) const;
+
+    // Encodes heights in the output format.
+    bool EncodeHeights(const uint16_t* heights, std::vector<unsigned char>& encodedTile) const;
+
+public:
+    TileWriter();
+
+    // Creates a single folder, failing if it already exists unless allowed (as when shards share an output folder).
+    static bool CreateFolder(std::string folder, bool allowExisting = false);
+
+    // Removes an empty folder.
+    static bool RemoveFolder(std::string folder);
+
+    // Lists the names of the files within a folder.
+    static bool ListFiles(std::string folder, std::vector<std::string>& fileNames);
+
+    void Setup(Settings* settings);
+
+    // Sets the threads each PNG is deflated on, or one per core if zero (the default).
+    // Callers encoding tiles from several threads at once should use 1, so the cores aren't oversubscribed.
+    void SetEncodeThreadCount(int threadCount);
+
+    // Returns the zoom of the base tiles, where zoom 0 is a single tile and each zoom doubles the tiles per side.
+    static int GetBaseZoom(int regionCount);
+
+    std::string GetPackFileName() const;
+
+    // Creates the base output folder. This will not overwrite an existing folder, unless exporting a tile range into it.
+    // When packing, also creates the tile pack.
+    bool CreateOutputFolder();
+
+    // Completes the output once every tile has been written, writing the directory of the tile pack when packing.
+    bool Finish();
+
+    // Creates the folder holding a row of tiles.
+    bool CreateRowFolder(int regionY);
+
+    // Gets the file name of a height tile.
+    std::string GetTileFileName(int regionX, int regionY) const;
+
+    // Gets the file name of the diagnostic cost map of a tile.
+    std::string GetCostTileFileName(int regionX, int regionY) const;
+
+    // Creates the [OutputFolder]/pyramid/[Zoom] folder and its row folders for a level of [TileCount]x[TileCount] tiles.
+    bool CreatePyramidFolders(int zoom, int tileCount);
+
+    // Gets the file name of a reduced tile of the pyramid, where zoom 0 is the single root tile.
+    std::string GetPyramidTileFileName(int zoom, int tileX, int tileY) const;
+
+    // Converts a [RegionSize]x[RegionSize] elevation raster into the 16-bit heights written to tiles.
+    void ToHeights(const double* rasterStore, uint16_t* heights) const;
+
+    // Writes a [RegionSize]x[RegionSize] elevation raster as a 16-bit heightmap tile.
+    bool WriteHeightTile(int regionX, int regionY, const double* rasterStore);
+
+    // Writes [RegionSize]x[RegionSize] heights as a tile of the pyramid.
+    bool WritePyramidTile(int zoom, int tileX, int tileY, const uint16_t* heights);
+
+    // Encodes a [RegionSize]x[RegionSize] elevation raster as an in-memory heightmap PNG, regardless of the output format.
+    bool EncodeHeightTile(const double* rasterStore, std::vector<unsigned char>& encodedTile) const;
+
+    // Writes the per-pixel search cost of a raster as a diagnostic tile.
+    bool WriteCostTile(int regionX, int regionY, const RasterCost* costStore);
+};
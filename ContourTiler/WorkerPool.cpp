@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <memory>
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(int threadCount, bool isNumaAware)
+    : topology(), isNumaAware(isNumaAware), isStopping(false)
+{
+    if (threadCount <= 0)
+    {
+        threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+
+    int nodeCount = isNumaAware ? topology.NodeCount() : 1;
+    tasks.resize(nodeCount);
+    nodeThreadCounts.resize(nodeCount, 0);
+
+    // Threads are split between the nodes by their share of the processors.
+    int processorCount = 0;
+    for (int node = 0; node < nodeCount; node++)
+    {
+        processorCount += topology.ProcessorCount(node);
+    }
+
+    int assignedThreads = 0;
+    int assignedProcessors = 0;
+    for (int node = 0; node < nodeCount; node++)
+    {
+        assignedProcessors += isNumaAware ? topology.ProcessorCount(node) : processorCount;
+        int nodeEndThread = (int)(((long long)threadCount * assignedProcessors) / processorCount);
+        for (int i = assignedThreads; i < nodeEndThread; i++)
+        {
+            workers.push_back(std::thread(&WorkerPool::RunWorker, this, node));
+        }
+
+        nodeThreadCounts[node] = nodeEndThread - assignedThreads;
+        assignedThreads = nodeEndThread;
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(taskMutex);
+        isStopping = true;
+    }
+
+    taskAvailable.notify_all();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+int WorkerPool::ThreadCount() const
+{
+    return (int)workers.size();
+}
+
+bool WorkerPool::TakeTask(int node, std::function<void()>& task)
+{
+    for (size_t i = 0; i < tasks.size(); i++)
+    {
+        std::queue<std::function<void()>>& nodeTasks = tasks[(node + i) % tasks.size()];
+        if (!nodeTasks.empty())
+        {
+            task = std::move(nodeTasks.front());
+            nodeTasks.pop();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WorkerPool::RunWorker(int node)
+{
+    if (isNumaAware)
+    {
+        topology.PinThread(node);
+    }
+
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(taskMutex);
+            taskAvailable.wait(lock, [this, node, &task] { return TakeTask(node, task) || isStopping; });
+            if (!task)
+            {
+                return;
+            }
+        }
+
+        task();
+    }
+}
+
+void WorkerPool::ParallelFor(int count, std::function<void(int)> operation)
+{
+    struct Completion
+    {
+        std::mutex mutex;
+        std::condition_variable done;
+        int remaining;
+    };
+
+    std::shared_ptr<Completion> completion = std::make_shared<Completion>();
+    completion->remaining = count;
+
+    {
+        std::lock_guard<std::mutex> lock(taskMutex);
+        int node = 0;
+        int nodeEndThread = nodeThreadCounts[0];
+        for (int i = 0; i < count; i++)
+        {
+            // Neighbouring indexes usually read neighbouring data, so each node gets a contiguous range.
+            while (node + 1 < (int)tasks.size() && (long long)i * ThreadCount() >= (long long)nodeEndThread * count)
+            {
+                ++node;
+                nodeEndThread += nodeThreadCounts[node];
+            }
+
+            tasks[node].push([completion, operation, i]()
+            {
+                operation(i);
+
+                std::lock_guard<std::mutex> completionLock(completion->mutex);
+                if (--completion->remaining == 0)
+                {
+                    completion->done.notify_all();
+                }
+            });
+        }
+    }
+
+    taskAvailable.notify_all();
+
+    std::unique_lock<std::mutex> lock(completion->mutex);
+    completion->done.wait(lock, [&completion] { return completion->remaining == 0; });
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "NumaTopology.h"
+
+// Fixed set of threads shared by everything that needs parallel work, so concurrent requests don't oversubscribe the cores.
+class WorkerPool
+{
+    NumaTopology topology;
+    bool isNumaAware;
+
+    std::vector<std::thread> workers;
+
+    // Tasks waiting for each NUMA node's workers, or all in the first queue if not NUMA aware.
+    std::vector<std::queue<std::function<void()>>> tasks;
+    std::vector<int> nodeThreadCounts;
+    std::mutex taskMutex;
+    std::condition_variable taskAvailable;
+    bool isStopping;
+
+    // Takes a task from the node's queue, or from another node's once its own queue is empty.
+    bool TakeTask(int node, std::function<void()>& task);
+
+    void RunWorker(int node);
+
+public:
+    // Creates a pool with the given number of threads, or one per hardware core if zero.
+    // If NUMA aware, threads are spread over the NUMA nodes, pinned to their node and take work from their node's queue first.
+    WorkerPool(int threadCount, bool isNumaAware = false);
+    virtual ~WorkerPool();
+
+    int ThreadCount() const;
+
+    // Runs the operation for each index in [0, count) on the pool, returning once all have completed.
+    // If NUMA aware, each node is given a contiguous range of indexes sized by its share of the threads.
+    void ParallelFor(int count, std::function<void(int)> operation);
+};